@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+// One block of memory that an instance's DSP buffers are carved out of, whatever their sample type.
+//
+// Every buffer handed out starts on a cache line boundary, which also satisfies the
+// alignment of any SIMD register width. The block is only reallocated when a layout
+// needs more room than it already has, so repeated prepareToPlay calls with the same
+// or a smaller configuration reuse it without touching the allocator. Memory is not
+// cleared when it is handed out.
+class AlignedArena
+{
+public:
+	// Alignment of every buffer, in bytes
+	static constexpr size_t alignment = 64;
+
+	// Number of bytes a buffer of numElements elements takes up, including padding up to the next aligned boundary
+	template <typename Type>
+	static size_t getAlignedSize(size_t numElements) noexcept
+	{
+		return (numElements * sizeof(Type) + alignment - 1) / alignment * alignment;
+	}
+
+	// Make room for numBytes bytes of aligned buffers, reallocating only if the arena is too small,
+	// and start handing out buffers from the beginning again. Returns true if it reallocated.
+	bool prepare(size_t numBytes)
+	{
+		mNumBytesUsed = 0;
+
+		if (numBytes <= mCapacity)
+			return false;
+
+		// Allocate enough extra to move the start up to an aligned address
+		mStorage.free();
+		mStorage.malloc(numBytes + alignment);
+
+		auto address = reinterpret_cast<uintptr_t>(mStorage.getData());
+		mData = reinterpret_cast<char*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		mCapacity = numBytes;
+
+		return true;
+	}
+
+	// Hand out the next aligned buffer of numElements elements
+	template <typename Type>
+	Type* allocate(size_t numElements) noexcept
+	{
+		jassert(mNumBytesUsed + getAlignedSize<Type>(numElements) <= mCapacity);
+
+		Type* buffer = reinterpret_cast<Type*>(mData + mNumBytesUsed);
+		mNumBytesUsed += getAlignedSize<Type>(numElements);
+
+		return buffer;
+	}
+
+	// Capacity in bytes
+	size_t getCapacity() const noexcept { return mCapacity; }
+
+private:
+	HeapBlock<char> mStorage;
+	char* mData = nullptr;
+	size_t mCapacity = 0;
+	size_t mNumBytesUsed = 0;
+};
@@ -0,0 +1,395 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../PluginProcessor.h"
+#include "RegressionSuite.h"
+
+#include <thread>
+
+//==============================================================================
+// Headless batch renderer: runs every WAV/AIFF file in a directory through
+// ChorusFlangerAudioProcessor without an editor or host.
+//
+// Usage:
+//   BatchRenderer --input <dir> --output <dir> [--program <n>] [--state <file>]
+//                 [--threads <n>] [--block-size <n>] [--bpm <tempo>] [--profile <file>]
+//                 [--<parameterID> <value> ...]
+//   BatchRenderer --write-references <dir> [--block-size <n>]
+//   BatchRenderer --regression <dir> [--block-size <n>] [--tolerance <difference>]
+//
+// --program starts from one of the built-in programs, and any state blob loaded
+// with --state is applied on top of it. Parameter flags use the processor's
+// parameter IDs (e.g. --dryWet 0.5 --type 1) and are applied last. Every file is rendered
+// as if the host transport were playing from the start of the file at --bpm, so
+// tempo-synced modulation matches a realtime bounce. When the processor is built
+// with CHORUSFLANGER_ENABLE_PROFILING, --profile writes each worker's stage
+// timings and CPU load histogram to a text file.
+//
+// --write-references renders the regression suite's deterministic signals into a
+// directory of reference WAV files. --regression renders them again, compares
+// them against those references within --tolerance (largest absolute sample
+// difference, 1e-5 by default) and runs null tests that need no references.
+// Either exits with a non-zero status if anything fails.
+//==============================================================================
+
+struct RenderSettings
+{
+	File inputDirectory, outputDirectory, stateFile, profileFile;
+	File referenceDirectory, regressionDirectory;
+	float tolerance = 1.0e-5f;
+	int program = -1;
+	int numThreads = 0;
+	int blockSize = 512;
+	double bpm = 120.0;
+	StringPairArray parameterValues;
+};
+
+// Transport that plays from the start of the file at a fixed tempo
+struct RenderPlayHead : public AudioPlayHead
+{
+	bool getCurrentPosition(CurrentPositionInfo& result) override
+	{
+		result = CurrentPositionInfo();
+		result.bpm = bpm;
+		result.timeSigNumerator = 4;
+		result.timeSigDenominator = 4;
+		result.timeInSamples = position;
+		result.timeInSeconds = position / sampleRate;
+		result.ppqPosition = result.timeInSeconds * bpm / 60.0;
+		result.isPlaying = true;
+		return true;
+	}
+
+	double bpm = 120.0;
+	double sampleRate = 44100.0;
+	int64 position = 0;
+};
+
+struct RenderResult
+{
+	bool succeeded = false;
+	double audioSeconds = 0.0;
+};
+
+// Print usage information
+static void printUsage()
+{
+	std::printf("Usage: BatchRenderer --input <dir> --output <dir> [--program <n>] [--state <file>]\n"
+				"                     [--threads <n>] [--block-size <n>] [--bpm <tempo>] [--profile <file>]\n"
+				"                     [--<parameterID> <value> ...]\n"
+				"       BatchRenderer --write-references <dir> [--block-size <n>]\n"
+				"       BatchRenderer --regression <dir> [--block-size <n>] [--tolerance <difference>]\n\n"
+				"Programs:\n");
+
+	ChorusFlangerAudioProcessor processor;
+
+	for (int program = 0; program < processor.getNumPrograms(); program++)
+		std::printf("  %-2d %s\n", program, processor.getProgramName(program).toRawUTF8());
+
+	std::printf("\nParameters:\n");
+
+	for (auto* parameter : processor.getParameters())
+		if (auto* ranged = dynamic_cast<RangedAudioParameter*>(parameter))
+			std::printf("  --%-14s %g to %g\n", ranged->paramID.toRawUTF8(),
+						ranged->getNormalisableRange().start, ranged->getNormalisableRange().end);
+}
+
+// Parse command line arguments, returning false if they are invalid
+static bool parseArguments(int argc, char* argv[], RenderSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		String option(argv[i]);
+
+		if (! option.startsWith("--") || i + 1 >= argc)
+			return false;
+
+		String value(argv[++i]);
+
+		if (option == "--input")
+			settings.inputDirectory = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--output")
+			settings.outputDirectory = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--program")
+			settings.program = value.getIntValue();
+		else if (option == "--state")
+			settings.stateFile = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--threads")
+			settings.numThreads = value.getIntValue();
+		else if (option == "--block-size")
+			settings.blockSize = value.getIntValue();
+		else if (option == "--bpm")
+			settings.bpm = value.getDoubleValue();
+		else if (option == "--profile")
+			settings.profileFile = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--write-references")
+			settings.referenceDirectory = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--regression")
+			settings.regressionDirectory = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--tolerance")
+			settings.tolerance = value.getFloatValue();
+		else
+			settings.parameterValues.set(option.substring(2), value);
+	}
+
+	// The regression suite renders its own signals
+	if (settings.referenceDirectory != File() || settings.regressionDirectory != File())
+		return settings.blockSize > 0 && settings.tolerance >= 0;
+
+	return settings.inputDirectory.isDirectory()
+		&& settings.outputDirectory != File()
+		&& settings.blockSize > 0
+		&& settings.bpm > 0;
+}
+
+// Build the state blob every worker's processor is initialized from
+static bool createStateBlob(const RenderSettings& settings, MemoryBlock& state)
+{
+	ChorusFlangerAudioProcessor processor;
+
+	if (settings.program >= 0)
+	{
+		if (settings.program >= processor.getNumPrograms())
+		{
+			std::printf("Unknown program %d\n", settings.program);
+			return false;
+		}
+
+		processor.setCurrentProgram(settings.program);
+	}
+
+	if (settings.stateFile != File())
+	{
+		MemoryBlock stateFileData;
+
+		if (! settings.stateFile.loadFileAsData(stateFileData))
+		{
+			std::printf("Could not read state file %s\n", settings.stateFile.getFullPathName().toRawUTF8());
+			return false;
+		}
+
+		processor.setStateInformation(stateFileData.getData(), (int)stateFileData.getSize());
+	}
+
+	for (auto& parameterID : settings.parameterValues.getAllKeys())
+	{
+		RangedAudioParameter* match = nullptr;
+
+		for (auto* parameter : processor.getParameters())
+			if (auto* ranged = dynamic_cast<RangedAudioParameter*>(parameter))
+				if (ranged->paramID == parameterID)
+					match = ranged;
+
+		if (match == nullptr)
+		{
+			std::printf("Unknown parameter --%s\n", parameterID.toRawUTF8());
+			return false;
+		}
+
+		auto value = settings.parameterValues[parameterID].getFloatValue();
+		match->setValueNotifyingHost(match->convertTo0to1(value));
+	}
+
+	processor.getStateInformation(state);
+	return true;
+}
+
+// Render a single file through the given processor
+static RenderResult renderFile(ChorusFlangerAudioProcessor& processor, AudioFormatManager& formatManager,
+							   const File& inputFile, const File& outputFile, int blockSize, double bpm)
+{
+	RenderResult result;
+
+	std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+
+	if (reader == nullptr)
+		return result;
+
+	auto* format = formatManager.findFormatForFileExtension(inputFile.getFileExtension());
+
+	if (format == nullptr)
+		return result;
+
+	auto numChannels = (int)reader->numChannels;
+
+	// Prepare processor for this file's channel count and sample rate
+	processor.setPlayConfigDetails(numChannels, numChannels, reader->sampleRate, blockSize);
+	processor.prepareToPlay(reader->sampleRate, blockSize);
+
+	outputFile.deleteFile();
+	std::unique_ptr<FileOutputStream> outputStream(outputFile.createOutputStream());
+
+	if (outputStream == nullptr)
+		return result;
+
+	std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(outputStream.get(), reader->sampleRate,
+		(unsigned int)numChannels, (int)reader->bitsPerSample, reader->metadataValues, 0));
+
+	if (writer == nullptr)
+		return result;
+
+	outputStream.release();
+
+	// Play the transport from the start of the file
+	RenderPlayHead playHead;
+	playHead.bpm = bpm;
+	playHead.sampleRate = reader->sampleRate;
+	processor.setPlayHead(&playHead);
+
+	// Render input followed by the processor's tail, running on for the oversampling latency and
+	// dropping that many samples from the start so the output lines up with the input
+	auto latency = (int64)processor.getLatencySamples();
+	auto tailLength = (int64)(processor.getTailLengthSeconds() * reader->sampleRate);
+	auto totalLength = reader->lengthInSamples + tailLength + latency;
+
+	AudioBuffer<float> buffer(numChannels, blockSize);
+	MidiBuffer midiMessages;
+	int64 position = 0;
+
+	for (; position < totalLength; position += blockSize)
+	{
+		auto numSamples = (int)jmin((int64)blockSize, totalLength - position);
+		AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+		block.clear();
+
+		if (position < reader->lengthInSamples)
+			reader->read(&block, 0, (int)jmin((int64)numSamples, reader->lengthInSamples - position), position, true, true);
+
+		playHead.position = position;
+		processor.processBlock(block, midiMessages);
+
+		auto numLatencySamples = (int)jlimit((int64)0, (int64)numSamples, latency - position);
+
+		if (numLatencySamples < numSamples
+			&& ! writer->writeFromAudioSampleBuffer(block, numLatencySamples, numSamples - numLatencySamples))
+			break;
+	}
+
+	processor.releaseResources();
+	processor.setPlayHead(nullptr);
+
+	// Writing stopped before the end of the file
+	if (position < totalLength)
+		return result;
+
+	result.succeeded = true;
+	result.audioSeconds = reader->lengthInSamples / reader->sampleRate;
+	return result;
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+	RenderSettings settings;
+
+	if (! parseArguments(argc, argv, settings))
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (settings.referenceDirectory != File() || settings.regressionDirectory != File())
+	{
+		RegressionSuite suite(settings.blockSize, settings.tolerance);
+
+		if (settings.referenceDirectory != File() && ! suite.writeReferences(settings.referenceDirectory))
+			return 1;
+
+		if (settings.regressionDirectory != File() && ! suite.run(settings.regressionDirectory))
+			return 1;
+
+		return 0;
+	}
+
+	MemoryBlock state;
+
+	if (! createStateBlob(settings, state))
+		return 1;
+
+	// Collect input files
+	auto inputFiles = settings.inputDirectory.findChildFiles(File::findFiles, false, "*.wav;*.aif;*.aiff");
+	inputFiles.sort();
+
+	if (! settings.outputDirectory.createDirectory())
+	{
+		std::printf("Could not create output directory %s\n", settings.outputDirectory.getFullPathName().toRawUTF8());
+		return 1;
+	}
+
+	auto numThreads = settings.numThreads > 0 ? settings.numThreads : SystemStats::getNumCpus();
+	numThreads = jmax(1, jmin(numThreads, inputFiles.size()));
+
+	std::atomic<int> nextFileIndex { 0 };
+	std::atomic<int> numFailures { 0 };
+	std::vector<double> audioSeconds((size_t)numThreads, 0.0);
+	std::vector<String> profileReports((size_t)numThreads);
+
+	auto startTime = Time::getMillisecondCounterHiRes();
+
+	// Each worker owns one processor and pulls files until none are left
+	std::vector<std::thread> workers;
+
+	for (int worker = 0; worker < numThreads; worker++)
+	{
+		workers.emplace_back([&, worker]
+		{
+			ChorusFlangerAudioProcessor processor;
+			processor.setStateInformation(state.getData(), (int)state.getSize());
+
+			AudioFormatManager workerFormatManager;
+			workerFormatManager.registerBasicFormats();
+
+			for (int index = nextFileIndex++; index < inputFiles.size(); index = nextFileIndex++)
+			{
+				auto inputFile = inputFiles.getReference(index);
+				auto outputFile = settings.outputDirectory.getChildFile(inputFile.getFileName());
+				auto result = renderFile(processor, workerFormatManager, inputFile, outputFile,
+									   settings.blockSize, settings.bpm);
+
+				if (result.succeeded)
+				{
+					audioSeconds[(size_t)worker] += result.audioSeconds;
+				}
+				else
+				{
+					std::printf("Failed to render %s\n", inputFile.getFullPathName().toRawUTF8());
+					numFailures++;
+				}
+			}
+
+		   #if CHORUSFLANGER_ENABLE_PROFILING
+			profileReports[(size_t)worker] = "Worker " + String(worker + 1) + "\n" + processor.getProfiler().createReportText();
+		   #endif
+		});
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+
+	// Report throughput
+	auto elapsedSeconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+	double totalAudioSeconds = 0.0;
+
+	for (auto seconds : audioSeconds)
+		totalAudioSeconds += seconds;
+
+	std::printf("Rendered %d of %d files (%.1f s of audio) in %.2f s using %d threads: %.1fx realtime\n",
+				inputFiles.size() - numFailures.load(), inputFiles.size(), totalAudioSeconds, elapsedSeconds,
+				numThreads, elapsedSeconds > 0.0 ? totalAudioSeconds / elapsedSeconds : 0.0);
+
+	// Write stage timings and load histograms
+	if (settings.profileFile != File())
+	{
+	   #if CHORUSFLANGER_ENABLE_PROFILING
+		String profile;
+
+		for (auto& report : profileReports)
+			profile << report << "\n";
+
+		if (! settings.profileFile.replaceWithText(profile))
+			std::printf("Could not write profile %s\n", settings.profileFile.getFullPathName().toRawUTF8());
+	   #else
+		std::printf("Profiling is not compiled in, rebuild with CHORUSFLANGER_ENABLE_PROFILING=1 to use --profile\n");
+	   #endif
+	}
+
+	return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,451 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../PluginProcessor.h"
+
+//==============================================================================
+// Golden output and null tests for the processor's DSP.
+//
+// Every case renders a deterministic stereo signal (an impulse, a sine sweep, noise, or silence
+// followed by a noise burst) through a fresh processor, for both Type settings and a grid of
+// Depth, Rate, Phase Offset and Feedback values. The grid is a half fraction of every combination,
+// chosen so each pair of values still appears together. Further cases take the sweep and the noise
+// through one other setting at a time: each interpolation mode, both oversampling factors, 4 and 8
+// voices, and sync to a straight and a triplet division with the transport playing at 120 BPM.
+// Renders are compared against reference WAV files written by an earlier, trusted build, and must
+// match within the reference tolerance.
+//
+// Null tests need no references: each case is also rendered with settings that must not change
+// the output, and the renders are compared with each other.
+//   - Interleaved frames instead of planar delay lines, and an offline render with each channel
+//     on its own thread, must be bit-identical.
+//   - A mono render must be bit-identical to the left channel of the stereo render, since channel
+//     0 has no phase spread.
+//   - With no Phase Offset both channels see the same LFO, so swapping the input channels must swap
+//     the output channels exactly. Together with the mono test, this catches one channel reading
+//     another channel's delay line or interpolation points.
+//   - A render in blocks of 61 samples must be bit-identical, except for the burst signal: idle blocks
+//     advance the LFO phase in one step rather than sample by sample, so where the processor goes
+//     idle depends on the block size.
+//   - A double precision render, rounded to float, must stay within doublePrecisionTolerance of the
+//     float render. The paths differ only by rounding, which feedback and the moving read heads
+//     build up over the signal, so this catches a broken double path rather than small changes.
+class RegressionSuite
+{
+public:
+	// Length of every rendered signal, and the rate it is rendered at
+	static constexpr int signalLength = 4096;
+	static constexpr double sampleRate = 44100.0;
+
+	// Largest difference allowed between double and float precision renders
+	static constexpr float doublePrecisionTolerance = 5.0e-3f;
+
+	RegressionSuite(int blockSize, float tolerance)
+		: mBlockSize(blockSize), mTolerance(tolerance)
+	{
+		mFormatManager.registerBasicFormats();
+
+		static const float types[] = { 0.0f, 1.0f };
+		static const float depths[] = { 0.25f, 1.0f };
+		static const float rates[] = { 0.5f, 8.0f };
+		static const float phaseOffsets[] = { 0.0f, 0.5f };
+		static const float feedbacks[] = { 0.0f, 0.9f };
+
+		static const Setting settings[] = {
+			{ "hermite", "interpolation", 1 }, { "lagrange4", "interpolation", 2 }, { "lagrange6", "interpolation", 3 },
+			{ "sinc", "interpolation", 4 }, { "oversampling2x", "oversampling", 1 }, { "oversampling4x", "oversampling", 2 },
+			{ "voices4", "voices", 4 }, { "voices8", "voices", 8 }, { "sync1-4", "sync", 5 }, { "sync1-8T", "sync", 9 }
+		};
+
+		for (int signal = 0; signal < numSignals; signal++)
+			for (auto type : types)
+				for (int depth = 0; depth < 2; depth++)
+					for (int rate = 0; rate < 2; rate++)
+						for (int phaseOffset = 0; phaseOffset < 2; phaseOffset++)
+						{
+							// Feedback follows the other three, which keeps every pair of values and halves the grid
+							const int feedback = (depth + rate + phaseOffset) % 2;
+							mCases.push_back({ signal, type, depths[depth], rates[rate], phaseOffsets[phaseOffset], feedbacks[feedback] });
+						}
+
+		// Phase Offset stays at 0 so the swapped channels test covers these settings too
+		for (auto signal : { sweepSignal, noiseSignal })
+			for (auto type : types)
+				for (auto& setting : settings)
+					mCases.push_back({ signal, type, 1.0f, 8.0f, 0.0f, 0.9f, &setting });
+	}
+
+	// Render every case into a 32-bit float WAV file in directory. Returns false if any file could not be written.
+	bool writeReferences(const File& directory)
+	{
+		if (! directory.createDirectory())
+		{
+			std::printf("Could not create reference directory %s\n", directory.getFullPathName().toRawUTF8());
+			return false;
+		}
+
+		int numWritten = 0;
+
+		for (auto& testCase : mCases)
+		{
+			auto file = directory.getChildFile(testCase.getName() + ".wav");
+
+			if (writeWav(file, render(testCase, RenderOptions(mBlockSize))))
+				numWritten++;
+			else
+				std::printf("Could not write %s\n", file.getFullPathName().toRawUTF8());
+		}
+
+		std::printf("Wrote %d of %d references to %s\n", numWritten, (int)mCases.size(), directory.getFullPathName().toRawUTF8());
+		return numWritten == (int)mCases.size();
+	}
+
+	// Render every case, compare it against its reference in directory and run the null tests, printing each
+	// failure and the largest difference every check found. Returns true if everything passed.
+	bool run(const File& directory)
+	{
+		enum Check { referenceCheck, interleavedCheck, offlineCheck, monoCheck, swapCheck, blockSizeCheck, doublePrecisionCheck, numChecks };
+
+		static const char* const checkNames[] = { "Reference", "Interleaved delay lines", "Offline threads",
+												  "Mono left channel", "Swapped channels", "Blocks of 61 samples", "Double precision" };
+		const float checkTolerances[] = { mTolerance, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, doublePrecisionTolerance };
+
+		float worstDifference[numChecks] = {};
+		int numFailures[numChecks] = {};
+		int numMissingReferences = 0;
+
+		for (auto& testCase : mCases)
+		{
+			auto output = render(testCase, RenderOptions(mBlockSize));
+			float difference[numChecks];
+
+			// Missing references are reported separately, so a first run without any does not hide the null tests
+			AudioBuffer<float> reference;
+			auto referenceFile = directory.getChildFile(testCase.getName() + ".wav");
+
+			if (readWav(referenceFile, reference))
+			{
+				difference[referenceCheck] = getMaxDifference(output, reference);
+			}
+			else
+			{
+				difference[referenceCheck] = 0;
+				numMissingReferences++;
+			}
+
+			RenderOptions interleaved(mBlockSize);
+			interleaved.interleaved = true;
+			difference[interleavedCheck] = getMaxDifference(output, render(testCase, interleaved));
+
+			RenderOptions offline(mBlockSize);
+			offline.offlineThreads = 2;
+			difference[offlineCheck] = getMaxDifference(output, render(testCase, offline));
+
+			RenderOptions mono(mBlockSize);
+			mono.numChannels = 1;
+			auto monoOutput = render(testCase, mono);
+			AudioBuffer<float> leftChannel(output.getArrayOfWritePointers(), 1, output.getNumSamples());
+			difference[monoCheck] = getMaxDifference(leftChannel, monoOutput);
+
+			difference[swapCheck] = 0;
+
+			if (testCase.phaseOffset == 0)
+			{
+				RenderOptions swapped(mBlockSize);
+				swapped.swapChannels = true;
+				difference[swapCheck] = getMaxDifference(output, render(testCase, swapped));
+			}
+
+			difference[blockSizeCheck] = 0;
+
+			if (testCase.signal != burstSignal)
+				difference[blockSizeCheck] = getMaxDifference(output, render(testCase, RenderOptions(61)));
+
+			RenderOptions doublePrecision(mBlockSize);
+			doublePrecision.doublePrecision = true;
+			difference[doublePrecisionCheck] = getMaxDifference(output, render(testCase, doublePrecision));
+
+			for (int check = 0; check < numChecks; check++)
+			{
+				worstDifference[check] = jmax(worstDifference[check], difference[check]);
+
+				// Differences are never negative, so this also fails on NaN and on renders of different lengths
+				if (! (difference[check] <= checkTolerances[check]))
+				{
+					numFailures[check]++;
+					std::printf("FAIL %-48s %-24s difference %g, tolerance %g\n", testCase.getName().toRawUTF8(),
+								checkNames[check], difference[check], checkTolerances[check]);
+				}
+			}
+		}
+
+		std::printf("\n%d cases, %d missing references\n\n", (int)mCases.size(), numMissingReferences);
+		std::printf("  %-24s %-14s %-14s %s\n", "Check", "Tolerance", "Worst", "Failures");
+
+		int totalFailures = numMissingReferences;
+
+		for (int check = 0; check < numChecks; check++)
+		{
+			std::printf("  %-24s %-14g %-14g %d\n", checkNames[check], checkTolerances[check], worstDifference[check], numFailures[check]);
+			totalFailures += numFailures[check];
+		}
+
+		return totalFailures == 0;
+	}
+
+private:
+	enum Signal { impulseSignal, sweepSignal, noiseSignal, burstSignal, numSignals };
+
+	// A parameter left at its default everywhere in the grid, and a value to test it at
+	struct Setting
+	{
+		const char* name;
+		const char* parameterID;
+		float value;
+	};
+
+	struct Case
+	{
+		int signal;
+		float type, depth, rate, phaseOffset, feedback;
+
+		// Setting applied on top of the others, if any
+		const Setting* setting = nullptr;
+
+		String getName() const
+		{
+			static const char* const signalNames[] = { "impulse", "sweep", "noise", "burst" };
+
+			return String(type == 0 ? "chorus" : "flanger") + "_" + signalNames[signal]
+				 + "_depth" + String(depth, 2) + "_rate" + String(rate, 2)
+				 + "_phase" + String(phaseOffset, 2) + "_feedback" + String(feedback, 2)
+				 + (setting != nullptr ? "_" + String(setting->name) : String());
+		}
+	};
+
+	// A transport playing from the start of the signal at 120 BPM, for the synced cases
+	struct PlayHead : public AudioPlayHead
+	{
+		bool getCurrentPosition(CurrentPositionInfo& result) override
+		{
+			result = CurrentPositionInfo();
+			result.bpm = 120.0;
+			result.timeInSamples = position;
+			result.timeInSeconds = position / sampleRate;
+			result.ppqPosition = result.timeInSeconds * 2.0;
+			result.isPlaying = true;
+			return true;
+		}
+
+		int64 position = 0;
+	};
+
+	// Settings a null test varies, all of which must leave the output unchanged
+	struct RenderOptions
+	{
+		explicit RenderOptions(int size) : blockSize(size) {}
+
+		int blockSize;
+		int numChannels = 2;
+		bool interleaved = false;
+
+		// Render as a non-realtime host would, with up to this many threads, or in realtime if 0
+		int offlineThreads = 0;
+
+		// Feed the left input to the right channel and vice versa, then swap the outputs back
+		bool swapChannels = false;
+
+		// Process in double precision and round the output to float
+		bool doublePrecision = false;
+	};
+
+	// Left and right differ in every signal, so a channel reading the other channel's samples shows up
+	static AudioBuffer<float> createSignal(int signal, int numChannels)
+	{
+		AudioBuffer<float> buffer(numChannels, signalLength);
+		buffer.clear();
+
+		for (int channel = 0; channel < numChannels; channel++)
+		{
+			float* samples = buffer.getWritePointer(channel);
+			Random random(channel + 1);
+
+			switch (signal)
+			{
+				case impulseSignal:
+					samples[channel * 64] = 1.0f;
+					break;
+
+				case sweepSignal:
+				{
+					// Exponential sweep from 20 Hz to 20 kHz, a quarter cycle apart between channels
+					const double duration = signalLength / sampleRate;
+					const double sweepRate = std::log(20000.0 / 20.0);
+
+					for (int i = 0; i < signalLength; i++)
+					{
+						const double time = i / sampleRate;
+						const double phase = 2 * double_Pi * 20.0 * duration / sweepRate * (std::exp(time / duration * sweepRate) - 1);
+						samples[i] = 0.5f * (float)std::sin(phase + channel * double_Pi / 2);
+					}
+
+					break;
+				}
+
+				case noiseSignal:
+					for (int i = 0; i < signalLength; i++)
+						samples[i] = random.nextFloat() - 0.5f;
+					break;
+
+				default:
+					// Long enough silence for the processor to go idle, then a burst that wakes it up
+					for (int i = signalLength * 3 / 4; i < signalLength; i++)
+						samples[i] = random.nextFloat() - 0.5f;
+					break;
+			}
+		}
+
+		return buffer;
+	}
+
+	AudioBuffer<float> render(const Case& testCase, const RenderOptions& options)
+	{
+		ChorusFlangerAudioProcessor processor;
+
+		setParameter(processor, "type", testCase.type);
+		setParameter(processor, "depth", testCase.depth);
+		setParameter(processor, "rate", testCase.rate);
+		setParameter(processor, "phaseOffset", testCase.phaseOffset);
+		setParameter(processor, "feedback", testCase.feedback);
+		setParameter(processor, "dryWet", 0.5f);
+
+		if (testCase.setting != nullptr)
+			setParameter(processor, testCase.setting->parameterID, testCase.setting->value);
+
+		processor.setInterleavedDelayLines(options.interleaved);
+		processor.setNonRealtime(options.offlineThreads > 0);
+		processor.setMaxOfflineThreads(options.offlineThreads);
+		processor.setProcessingPrecision(options.doublePrecision ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision);
+		processor.setPlayConfigDetails(options.numChannels, options.numChannels, sampleRate, options.blockSize);
+		processor.prepareToPlay(sampleRate, options.blockSize);
+
+		auto buffer = createSignal(testCase.signal, options.numChannels);
+
+		if (options.doublePrecision)
+		{
+			AudioBuffer<double> doubleBuffer;
+			doubleBuffer.makeCopyOf(buffer);
+
+			processSignal(processor, doubleBuffer, options);
+			buffer.makeCopyOf(doubleBuffer);
+		}
+		else
+		{
+			processSignal(processor, buffer, options);
+		}
+
+		processor.releaseResources();
+		return buffer;
+	}
+
+	// Process a whole signal in place, in blocks of the options' size
+	template <typename SampleType>
+	static void processSignal(ChorusFlangerAudioProcessor& processor, AudioBuffer<SampleType>& buffer, const RenderOptions& options)
+	{
+		MidiBuffer midiMessages;
+		PlayHead playHead;
+		processor.setPlayHead(&playHead);
+
+		// Channel order the processor sees
+		SampleType* channels[2] = { buffer.getWritePointer(0), buffer.getWritePointer(options.numChannels - 1) };
+
+		if (options.swapChannels)
+			std::swap(channels[0], channels[1]);
+
+		for (int start = 0; start < signalLength; start += options.blockSize)
+		{
+			AudioBuffer<SampleType> block(channels, options.numChannels, start, jmin(options.blockSize, signalLength - start));
+			playHead.position = start;
+			processor.processBlock(block, midiMessages);
+		}
+
+		processor.setPlayHead(nullptr);
+	}
+
+	static void setParameter(AudioProcessor& processor, const String& parameterID, float value)
+	{
+		for (auto* parameter : processor.getParameters())
+			if (auto* ranged = dynamic_cast<RangedAudioParameter*>(parameter))
+				if (ranged->paramID == parameterID)
+					ranged->setValueNotifyingHost(ranged->convertTo0to1(value));
+	}
+
+	// Largest absolute difference between two renders, or infinity if their sizes differ
+	static float getMaxDifference(const AudioBuffer<float>& a, const AudioBuffer<float>& b)
+	{
+		if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+			return std::numeric_limits<float>::infinity();
+
+		float difference = 0;
+
+		for (int channel = 0; channel < a.getNumChannels(); channel++)
+		{
+			const float* x = a.getReadPointer(channel);
+			const float* y = b.getReadPointer(channel);
+
+			for (int i = 0; i < a.getNumSamples(); i++)
+			{
+				const float sampleDifference = std::abs(x[i] - y[i]);
+
+				// Keep NaN, which a comparison with jmax would drop
+				if (! (sampleDifference <= difference))
+					difference = sampleDifference;
+			}
+		}
+
+		return difference;
+	}
+
+	bool writeWav(const File& file, const AudioBuffer<float>& buffer)
+	{
+		auto* format = mFormatManager.findFormatForFileExtension("wav");
+
+		if (format == nullptr)
+			return false;
+
+		file.deleteFile();
+		std::unique_ptr<FileOutputStream> stream(file.createOutputStream());
+
+		if (stream == nullptr)
+			return false;
+
+		// 32-bit WAV files hold floats, so references keep every bit of the render
+		std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate,
+			(unsigned int)buffer.getNumChannels(), 32, {}, 0));
+
+		if (writer == nullptr)
+			return false;
+
+		stream.release();
+		return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+	}
+
+	bool readWav(const File& file, AudioBuffer<float>& buffer)
+	{
+		if (! file.existsAsFile())
+			return false;
+
+		std::unique_ptr<AudioFormatReader> reader(mFormatManager.createReaderFor(file));
+
+		if (reader == nullptr)
+			return false;
+
+		buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
+		return reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+	}
+
+	int mBlockSize;
+	float mTolerance;
+	std::vector<Case> mCases;
+	AudioFormatManager mFormatManager;
+};
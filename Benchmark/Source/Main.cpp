@@ -0,0 +1,629 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../PluginProcessor.h"
+
+//==============================================================================
+// Microbenchmarks for the ChorusFlangerAudioProcessor hot path.
+//
+// Usage:
+//   Benchmark [--seconds <audio seconds per case>] [--json <output file>] [--compare <baseline file>] [--full]
+//
+// processBlock is timed for every interpolation mode, oversampling factor and
+// voice count at 48 kHz and a 64 sample buffer, and for each block size, sample
+// rate, Type and Feedback setting with the others at those defaults. --full times
+// every combination of them instead, which takes far longer. The LFO, delay time,
+// delay read, meter and mix stages that processBlock runs are then timed on their
+// own, along with each interpolation mode. Many instances sharing one core are
+// timed with planar and interleaved delay buffers, to show how the layout copes
+// once their delay lines no longer fit in cache together. The LFO wavetable's
+// accuracy is measured too. Results can be written as a JSON baseline and compared
+// against a previous run.
+//==============================================================================
+
+static const int blockSizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+static const int defaultBlockSize = 64;
+static const double defaultSampleRate = 48000.0;
+static const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+static const float feedbackSettings[] = { 0.0f, 0.7f };
+static const float defaultFeedback = 0.7f;
+static const int voiceCounts[] = { 1, 4, 8 };
+static const int sharedCoreInstanceCounts[] = { 1, 8, 32, 128, 512 };
+static const int offlineThreadCounts[] = { 1, 2, 4, 8 };
+
+// Prevents the compiler from optimizing away benchmarked work
+static volatile float benchmarkSink;
+
+// Find a parameter by ID, returning nullptr if the processor does not have it
+static RangedAudioParameter* findParameter(ChorusFlangerAudioProcessor& processor, const String& parameterID)
+{
+	for (auto* parameter : processor.getParameters())
+		if (auto* ranged = dynamic_cast<RangedAudioParameter*>(parameter))
+			if (ranged->paramID == parameterID)
+				return ranged;
+
+	return nullptr;
+}
+
+// Set a parameter by ID to an unnormalised value
+static void setParameter(ChorusFlangerAudioProcessor& processor, const String& parameterID, float value)
+{
+	if (auto* parameter = findParameter(processor, parameterID))
+		parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+// Convert elapsed high resolution ticks to nanoseconds
+static double ticksToNanoseconds(int64 ticks)
+{
+	return ticks * 1.0e9 / Time::getHighResolutionTicksPerSecond();
+}
+
+//==============================================================================
+struct BenchmarkCase
+{
+	int blockSize;
+	double sampleRate;
+	int type;
+	float feedback;
+	int interpolationMode;
+	String interpolationName;
+	int oversamplingMode;
+	String oversamplingName;
+	int numVoices;
+
+	String getName() const
+	{
+		return String(type == 0 ? "chorus" : "flanger")
+			+ "/fb" + String(feedback, 1)
+			+ "/" + interpolationName
+			+ "/os" + oversamplingName
+			+ "/v" + String(numVoices)
+			+ "/" + String((int)sampleRate)
+			+ "/" + String(blockSize);
+	}
+};
+
+// Time processBlock for one case, returning nanoseconds per sample
+static double runProcessBlockCase(const BenchmarkCase& benchmarkCase, double secondsOfAudio)
+{
+	ChorusFlangerAudioProcessor processor;
+
+	setParameter(processor, "dryWet", 0.5f);
+	setParameter(processor, "depth", 0.7f);
+	setParameter(processor, "rate", 3.0f);
+	setParameter(processor, "phaseOffset", 0.25f);
+	setParameter(processor, "feedback", benchmarkCase.feedback);
+	setParameter(processor, "type", (float)benchmarkCase.type);
+	setParameter(processor, "interpolation", (float)benchmarkCase.interpolationMode);
+	setParameter(processor, "oversampling", (float)benchmarkCase.oversamplingMode);
+	setParameter(processor, "voices", (float)benchmarkCase.numVoices);
+
+	processor.setRateAndBufferSizeDetails(benchmarkCase.sampleRate, benchmarkCase.blockSize);
+	processor.prepareToPlay(benchmarkCase.sampleRate, benchmarkCase.blockSize);
+
+	// Fill input with noise so every stage does real work
+	AudioBuffer<float> input(processor.getTotalNumOutputChannels(), benchmarkCase.blockSize);
+	AudioBuffer<float> buffer(input.getNumChannels(), benchmarkCase.blockSize);
+	MidiBuffer midiMessages;
+	Random random(1);
+
+	for (int channel = 0; channel < input.getNumChannels(); channel++)
+		for (int i = 0; i < benchmarkCase.blockSize; i++)
+			input.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+	auto numBlocks = jmax(1, (int)(secondsOfAudio * benchmarkCase.sampleRate / benchmarkCase.blockSize));
+
+	// Warm up caches and branch predictors
+	for (int block = 0; block < jmin(numBlocks, 64); block++)
+	{
+		buffer.makeCopyOf(input, true);
+		processor.processBlock(buffer, midiMessages);
+	}
+
+	int64 elapsedTicks = 0;
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		buffer.makeCopyOf(input, true);
+
+		auto startTicks = Time::getHighResolutionTicks();
+		processor.processBlock(buffer, midiMessages);
+		elapsedTicks += Time::getHighResolutionTicks() - startTicks;
+	}
+
+	benchmarkSink = buffer.getSample(0, 0);
+
+	return ticksToNanoseconds(elapsedTicks) / ((double)numBlocks * benchmarkCase.blockSize);
+}
+
+//==============================================================================
+// Time a number of stereo instances processed one after another at a 64 sample buffer, as a host
+// would run them on one core, returning nanoseconds per sample of each instance. Every instance
+// has its own delay buffers, so beyond a few instances they evict each other from cache.
+static double runSharedCoreCase(int numInstances, bool interleaveDelayLines, double secondsOfAudio)
+{
+	const double sampleRate = 48000.0;
+	const int blockSize = 64;
+
+	OwnedArray<ChorusFlangerAudioProcessor> processors;
+
+	for (int instance = 0; instance < numInstances; instance++)
+	{
+		auto* processor = processors.add(new ChorusFlangerAudioProcessor());
+
+		setParameter(*processor, "dryWet", 0.5f);
+		setParameter(*processor, "depth", 0.7f);
+		setParameter(*processor, "rate", 3.0f);
+		setParameter(*processor, "phaseOffset", 0.25f);
+		setParameter(*processor, "feedback", 0.7f);
+		setParameter(*processor, "voices", 4.0f);
+
+		processor->setInterleavedDelayLines(interleaveDelayLines);
+		processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+		processor->prepareToPlay(sampleRate, blockSize);
+	}
+
+	AudioBuffer<float> input(processors[0]->getTotalNumOutputChannels(), blockSize);
+	AudioBuffer<float> buffer(input.getNumChannels(), blockSize);
+	MidiBuffer midiMessages;
+	Random random(1);
+
+	for (int channel = 0; channel < input.getNumChannels(); channel++)
+		for (int i = 0; i < blockSize; i++)
+			input.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+	// Every instance processes secondsOfAudio, so the whole run covers numInstances times as much
+	auto numBlocks = jmax(1, (int)(secondsOfAudio * sampleRate / blockSize));
+
+	// Warm up until the delay lines have been written through at least once
+	for (int block = 0; block < jmin(numBlocks, 64); block++)
+	{
+		for (auto* processor : processors)
+		{
+			buffer.makeCopyOf(input, true);
+			processor->processBlock(buffer, midiMessages);
+		}
+	}
+
+	int64 elapsedTicks = 0;
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		for (auto* processor : processors)
+		{
+			buffer.makeCopyOf(input, true);
+
+			auto startTicks = Time::getHighResolutionTicks();
+			processor->processBlock(buffer, midiMessages);
+			elapsedTicks += Time::getHighResolutionTicks() - startTicks;
+		}
+	}
+
+	benchmarkSink = buffer.getSample(0, 0);
+
+	return ticksToNanoseconds(elapsedTicks) / ((double)numBlocks * numInstances * blockSize);
+}
+
+//==============================================================================
+// Time a 7.1 instance rendering offline with up to numThreads threads sharing its channels, returning
+// nanoseconds per sample of each channel. One thread runs every channel on the calling thread.
+static double runOfflineCase(int numVoices, int interpolationMode, int oversamplingMode, int numThreads, double secondsOfAudio)
+{
+	const double sampleRate = 48000.0;
+	const int blockSize = 512;
+	const int numChannels = 8;
+
+	ChorusFlangerAudioProcessor processor;
+
+	setParameter(processor, "dryWet", 0.5f);
+	setParameter(processor, "depth", 0.7f);
+	setParameter(processor, "rate", 3.0f);
+	setParameter(processor, "phaseOffset", 0.25f);
+	setParameter(processor, "feedback", 0.7f);
+	setParameter(processor, "interpolation", (float)interpolationMode);
+	setParameter(processor, "oversampling", (float)oversamplingMode);
+	setParameter(processor, "voices", (float)numVoices);
+
+	processor.setNonRealtime(true);
+	processor.setMaxOfflineThreads(numThreads);
+	processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+	processor.prepareToPlay(sampleRate, blockSize);
+
+	AudioBuffer<float> input(numChannels, blockSize);
+	AudioBuffer<float> buffer(numChannels, blockSize);
+	MidiBuffer midiMessages;
+	Random random(1);
+
+	for (int channel = 0; channel < numChannels; channel++)
+		for (int i = 0; i < blockSize; i++)
+			input.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+	auto numBlocks = jmax(1, (int)(secondsOfAudio * sampleRate / blockSize));
+
+	for (int block = 0; block < jmin(numBlocks, 64); block++)
+	{
+		buffer.makeCopyOf(input, true);
+		processor.processBlock(buffer, midiMessages);
+	}
+
+	int64 elapsedTicks = 0;
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		buffer.makeCopyOf(input, true);
+
+		auto startTicks = Time::getHighResolutionTicks();
+		processor.processBlock(buffer, midiMessages);
+		elapsedTicks += Time::getHighResolutionTicks() - startTicks;
+	}
+
+	benchmarkSink = buffer.getSample(0, 0);
+
+	return ticksToNanoseconds(elapsedTicks) / ((double)numBlocks * numChannels * blockSize);
+}
+
+//==============================================================================
+// Time one of the block processing stages on its own, over a 64 sample segment of the first channel of a
+// stereo instance at 48 kHz, returning nanoseconds per sample. A block is processed first, so the
+// parameters have been read and the scratch buffers the stage reads hold real values.
+template <typename Stage>
+static double runStageBenchmark(int numVoices, int numSegments, Stage stage)
+{
+	const int numSamples = PARAMETER_SEGMENT_LENGTH;
+
+	ChorusFlangerAudioProcessor processor;
+
+	setParameter(processor, "dryWet", 0.5f);
+	setParameter(processor, "depth", 0.7f);
+	setParameter(processor, "rate", 3.0f);
+	setParameter(processor, "phaseOffset", 0.25f);
+	setParameter(processor, "feedback", 0.7f);
+	setParameter(processor, "voices", (float)numVoices);
+
+	processor.setRateAndBufferSizeDetails(defaultSampleRate, numSamples);
+	processor.prepareToPlay(defaultSampleRate, numSamples);
+
+	AudioBuffer<float> buffer(processor.getTotalNumOutputChannels(), numSamples);
+	MidiBuffer midiMessages;
+	Random random(1);
+
+	for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+		for (int i = 0; i < numSamples; i++)
+			buffer.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+	processor.processBlock(buffer, midiMessages);
+
+	float* channelData = buffer.getWritePointer(0);
+
+	// Warm up caches and branch predictors
+	for (int segment = 0; segment < jmin(numSegments, 64); segment++)
+		stage(processor, channelData, numSamples);
+
+	auto startTicks = Time::getHighResolutionTicks();
+
+	for (int segment = 0; segment < numSegments; segment++)
+		stage(processor, channelData, numSamples);
+
+	auto elapsedTicks = Time::getHighResolutionTicks() - startTicks;
+	benchmarkSink = channelData[0];
+
+	return ticksToNanoseconds(elapsedTicks) / ((double)numSegments * numSamples);
+}
+
+// Time the delay read stage with one interpolation mode
+template <int interpolation>
+static double runDelayReadStageBenchmark(int numVoices, int numSegments)
+{
+	return runStageBenchmark(numVoices, numSegments, [] (ChorusFlangerAudioProcessor& processor, float* channelData, int numSamples)
+	{
+		processor.processDelayReadStage<float, interpolation>(channelData, 0, numSamples);
+	});
+}
+
+// Time a single interpolation mode reading a delay buffer of noise, returning nanoseconds per call
+template <int mode>
+static double runInterpolationBenchmark(int numCalls)
+{
+	SincInterpolationTable sincTable;
+	sincTable.build();
+
+	const int bufferLength = 2048;
+	HeapBlock<float> buffer((size_t)bufferLength);
+	Random random(1);
+
+	for (int i = 0; i < bufferLength; i++)
+		buffer[i] = random.nextFloat() * 2.0f - 1.0f;
+
+	float sum = 0;
+	auto startTicks = Time::getHighResolutionTicks();
+
+	for (int i = 0; i < numCalls; i++)
+	{
+		auto readHead = (float)(i & 1023) + bufferLength + 0.37f;
+		sum += interpolateDelayBuffer<mode>(buffer.getData(), bufferLength - 1, 1, readHead, sincTable.getCoefficients());
+	}
+
+	auto elapsedTicks = Time::getHighResolutionTicks() - startTicks;
+	benchmarkSink = sum;
+
+	return ticksToNanoseconds(elapsedTicks) / numCalls;
+}
+
+// Measure the largest deviation of the LFO wavetable from std::sin
+static double measureLFOWavetableError(int numPhases)
+{
+	LFOWavetable wavetable;
+	wavetable.build();
+
+	double maxError = 0;
+
+	for (int i = 0; i < numPhases; i++)
+	{
+		auto phase = (float)i / numPhases;
+		auto error = std::abs(wavetable.lookup(phase) - (float)std::sin(2 * double_Pi * phase));
+		maxError = jmax(maxError, (double)error);
+	}
+
+	return maxError;
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+	double secondsOfAudio = 0.5;
+	bool fullSweep = false;
+	File jsonFile, baselineFile;
+
+	for (int i = 1; i < argc; i++)
+	{
+		String option(argv[i]);
+
+		if (option == "--full")
+		{
+			fullSweep = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+			break;
+
+		String value(argv[++i]);
+
+		if (option == "--seconds")
+			secondsOfAudio = value.getDoubleValue();
+		else if (option == "--json")
+			jsonFile = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--compare")
+			baselineFile = File::getCurrentWorkingDirectory().getChildFile(value);
+	}
+
+	// Load a previous run to compare against
+	var baseline;
+
+	if (baselineFile.existsAsFile())
+		baseline = JSON::parse(baselineFile);
+
+	// Benchmark every interpolation mode and oversampling factor the processor offers
+	StringArray interpolationNames { "linear" };
+	StringArray oversamplingNames { "Off" };
+	ChorusFlangerAudioProcessor probe;
+
+	if (auto* interpolation = dynamic_cast<AudioParameterChoice*>(findParameter(probe, "interpolation")))
+		interpolationNames = interpolation->choices;
+
+	if (auto* oversampling = dynamic_cast<AudioParameterChoice*>(findParameter(probe, "oversampling")))
+		oversamplingNames = oversampling->choices;
+
+	DynamicObject::Ptr results = new DynamicObject();
+	DynamicObject::Ptr processBlockResults = new DynamicObject();
+	DynamicObject::Ptr instancesPerCore = new DynamicObject();
+
+	std::printf("%-52s %10s %10s\n", "processBlock", "ns/sample", "vs base");
+
+	// Build every combination of settings for the full sweep. Otherwise time every combination of interpolation,
+	// oversampling and voices at the default block size, sample rate, Type and Feedback, then vary each of those
+	// on its own, so a baseline can be taken and compared against in a few seconds.
+	std::vector<BenchmarkCase> benchmarkCases;
+	StringArray benchmarkCaseNames;
+
+	auto addCase = [&] (int blockSize, double sampleRate, int type, float feedback, int mode, int oversampling, int numVoices)
+	{
+		BenchmarkCase benchmarkCase { blockSize, sampleRate, type, feedback, mode, interpolationNames[mode],
+									  oversampling, oversamplingNames[oversampling], numVoices };
+
+		if (benchmarkCaseNames.addIfNotAlreadyThere(benchmarkCase.getName()))
+			benchmarkCases.push_back(benchmarkCase);
+	};
+
+	if (fullSweep)
+	{
+		for (int type = 0; type <= 1; type++)
+			for (auto feedback : feedbackSettings)
+				for (int mode = 0; mode < interpolationNames.size(); mode++)
+					for (int oversampling = 0; oversampling < oversamplingNames.size(); oversampling++)
+						for (auto numVoices : voiceCounts)
+							for (auto sampleRate : sampleRates)
+								for (auto blockSize : blockSizes)
+									addCase(blockSize, sampleRate, type, feedback, mode, oversampling, numVoices);
+	}
+	else
+	{
+		for (int mode = 0; mode < interpolationNames.size(); mode++)
+			for (int oversampling = 0; oversampling < oversamplingNames.size(); oversampling++)
+				for (auto numVoices : voiceCounts)
+					addCase(defaultBlockSize, defaultSampleRate, 0, defaultFeedback, mode, oversampling, numVoices);
+
+		for (auto blockSize : blockSizes)
+			addCase(blockSize, defaultSampleRate, 0, defaultFeedback, 0, 0, 1);
+
+		for (auto sampleRate : sampleRates)
+			addCase(defaultBlockSize, sampleRate, 0, defaultFeedback, 0, 0, 1);
+
+		for (auto feedback : feedbackSettings)
+			addCase(defaultBlockSize, defaultSampleRate, 1, feedback, 0, 0, 1);
+
+		addCase(defaultBlockSize, defaultSampleRate, 0, 0.0f, 0, 0, 1);
+	}
+
+	for (auto& benchmarkCase : benchmarkCases)
+	{
+		auto name = benchmarkCase.getName();
+		auto nsPerSample = runProcessBlockCase(benchmarkCase, secondsOfAudio);
+
+		processBlockResults->setProperty(name, nsPerSample);
+
+		// Instances that fit in one core's realtime budget at a 64 sample buffer
+		if (benchmarkCase.blockSize == 64)
+			instancesPerCore->setProperty(name, 1.0e9 / (nsPerSample * benchmarkCase.sampleRate));
+
+		String comparison;
+		auto baselineValue = baseline["processBlock"][Identifier(name)];
+
+		if (! baselineValue.isVoid())
+			comparison = String(100.0 * (nsPerSample / (double)baselineValue - 1.0), 1) + "%";
+
+		std::printf("%-52s %10.2f %10s\n", name.toRawUTF8(), nsPerSample, comparison.toRawUTF8());
+	}
+
+	std::printf("\n%-52s %10s\n", "Instances per core (64 samples)", "instances");
+
+	for (auto& property : instancesPerCore->getProperties())
+		std::printf("%-52s %10.1f\n", property.name.toString().toRawUTF8(), (double)property.value);
+
+	// Instances sharing a core, with planar and interleaved delay buffers
+	DynamicObject::Ptr sharedCoreResults = new DynamicObject();
+
+	std::printf("\n%-52s %10s %10s\n", "Instances sharing a core (48 kHz, 64 samples)", "ns/sample", "vs base");
+
+	for (auto numInstances : sharedCoreInstanceCounts)
+	{
+		for (int interleave = 0; interleave <= 1; interleave++)
+		{
+			auto name = String(numInstances) + " instances/" + (interleave ? "interleaved" : "planar");
+			auto nsPerSample = runSharedCoreCase(numInstances, interleave != 0, secondsOfAudio);
+
+			sharedCoreResults->setProperty(name, nsPerSample);
+
+			String comparison;
+			auto baselineValue = baseline["sharedCore"][Identifier(name)];
+
+			if (! baselineValue.isVoid())
+				comparison = String(100.0 * (nsPerSample / (double)baselineValue - 1.0), 1) + "%";
+
+			std::printf("%-52s %10.2f %10s\n", name.toRawUTF8(), nsPerSample, comparison.toRawUTF8());
+		}
+	}
+
+	// Offline rendering of a 7.1 instance with its channels split across threads, for the cheapest
+	// settings and the most expensive ones
+	DynamicObject::Ptr offlineResults = new DynamicObject();
+
+	std::printf("\n%-52s %10s %10s\n", "Offline rendering (7.1, 48 kHz, 512 samples)", "ns/sample", "vs base");
+
+	for (int expensive = 0; expensive <= 1; expensive++)
+	{
+		const int mode = expensive ? interpolationNames.size() - 1 : 0;
+		const int oversampling = expensive ? oversamplingNames.size() - 1 : 0;
+		const int numVoices = expensive ? MAX_VOICES : 1;
+
+		for (auto numThreads : offlineThreadCounts)
+		{
+			auto name = interpolationNames[mode] + "/os" + oversamplingNames[oversampling] + "/v" + String(numVoices)
+					  + "/" + String(numThreads) + (numThreads == 1 ? " thread" : " threads");
+			auto nsPerSample = runOfflineCase(numVoices, mode, oversampling, numThreads, secondsOfAudio);
+
+			offlineResults->setProperty(name, nsPerSample);
+
+			String comparison;
+			auto baselineValue = baseline["offline"][Identifier(name)];
+
+			if (! baselineValue.isVoid())
+				comparison = String(100.0 * (nsPerSample / (double)baselineValue - 1.0), 1) + "%";
+
+			std::printf("%-52s %10.2f %10s\n", name.toRawUTF8(), nsPerSample, comparison.toRawUTF8());
+		}
+	}
+
+	// Block processing stages on their own, for one channel of a stereo instance
+	DynamicObject::Ptr stageResults = new DynamicObject();
+	const int numStageSegments = 1 << 15;
+
+	static double (* const delayReadStageBenchmarks[])(int, int) = { runDelayReadStageBenchmark<linearInterpolation>,
+																	 runDelayReadStageBenchmark<hermiteInterpolation>,
+																	 runDelayReadStageBenchmark<lagrange4Interpolation>,
+																	 runDelayReadStageBenchmark<lagrange6Interpolation>,
+																	 runDelayReadStageBenchmark<sincInterpolation> };
+
+	for (auto numVoices : voiceCounts)
+	{
+		stageResults->setProperty("lfo/v" + String(numVoices),
+			runStageBenchmark(numVoices, numStageSegments, [] (ChorusFlangerAudioProcessor& processor, float*, int numSamples)
+			{
+				processor.processLFOStage<float>(0, 0, numSamples);
+			}));
+
+		stageResults->setProperty("delayTime/v" + String(numVoices),
+			runStageBenchmark(numVoices, numStageSegments, [] (ChorusFlangerAudioProcessor& processor, float*, int numSamples)
+			{
+				processor.processDelayTimeStage<float>(0, 0, numSamples);
+			}));
+
+		for (int mode = 0; mode < jmin(interpolationNames.size(), (int)numElementsInArray(delayReadStageBenchmarks)); mode++)
+			stageResults->setProperty("delayRead/" + interpolationNames[mode] + "/v" + String(numVoices),
+									  delayReadStageBenchmarks[mode](numVoices, numStageSegments));
+	}
+
+	stageResults->setProperty("meter", runStageBenchmark(1, numStageSegments, [] (ChorusFlangerAudioProcessor& processor, float*, int numSamples)
+	{
+		processor.processMeterStage<float>(0, numSamples);
+	}));
+
+	stageResults->setProperty("mix", runStageBenchmark(1, numStageSegments, [] (ChorusFlangerAudioProcessor& processor, float* channelData, int numSamples)
+	{
+		processor.processMixStage<float>(channelData, 0, numSamples);
+	}));
+
+	std::printf("\n%-52s %10s %10s\n", "Stages (48 kHz, 64 samples)", "ns/sample", "vs base");
+
+	for (auto& property : stageResults->getProperties())
+	{
+		String comparison;
+		auto baselineValue = baseline["stages"][property.name];
+
+		if (! baselineValue.isVoid())
+			comparison = String(100.0 * ((double)property.value / (double)baselineValue - 1.0), 1) + "%";
+
+		std::printf("%-52s %10.2f %10s\n", property.name.toString().toRawUTF8(), (double)property.value, comparison.toRawUTF8());
+	}
+
+	// Each interpolation mode reading a delay buffer, outside the delay read stage
+	DynamicObject::Ptr interpolationResults = new DynamicObject();
+	const int numInterpolationCalls = 1 << 22;
+
+	interpolationResults->setProperty("linear", runInterpolationBenchmark<linearInterpolation>(numInterpolationCalls));
+	interpolationResults->setProperty("hermite", runInterpolationBenchmark<hermiteInterpolation>(numInterpolationCalls));
+	interpolationResults->setProperty("lagrange4", runInterpolationBenchmark<lagrange4Interpolation>(numInterpolationCalls));
+	interpolationResults->setProperty("lagrange6", runInterpolationBenchmark<lagrange6Interpolation>(numInterpolationCalls));
+	interpolationResults->setProperty("sinc", runInterpolationBenchmark<sincInterpolation>(numInterpolationCalls));
+
+	std::printf("\n%-52s %10s\n", "Interpolation", "ns/call");
+
+	for (auto& property : interpolationResults->getProperties())
+		std::printf("%-52s %10.2f\n", property.name.toString().toRawUTF8(), (double)property.value);
+
+	// LFO accuracy
+	auto lfoError = measureLFOWavetableError(1 << 24);
+	std::printf("\n%-52s %10.3g\n", "LFO wavetable max error vs std::sin", lfoError);
+
+	// Write JSON baseline
+	results->setProperty("processBlock", var(processBlockResults.get()));
+	results->setProperty("instancesPerCore64", var(instancesPerCore.get()));
+	results->setProperty("sharedCore", var(sharedCoreResults.get()));
+	results->setProperty("offline", var(offlineResults.get()));
+	results->setProperty("stages", var(stageResults.get()));
+	results->setProperty("interpolation", var(interpolationResults.get()));
+	results->setProperty("lfoWavetableMaxError", lfoError);
+
+	if (jsonFile != File())
+		jsonFile.replaceWithText(JSON::toString(var(results.get())));
+
+	return 0;
+}
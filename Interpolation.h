@@ -0,0 +1,169 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Number of delay buffer points read by the widest interpolator
+#define MAX_INTERPOLATION_POINTS 16
+
+//==============================================================================
+// Fractional delay interpolation modes, in the order of the Interpolation parameter
+enum InterpolationMode
+{
+	linearInterpolation,
+	hermiteInterpolation,
+	lagrange4Interpolation,
+	lagrange6Interpolation,
+	sincInterpolation,
+	numInterpolationModes
+};
+
+//==============================================================================
+// Polyphase Blackman-windowed sinc coefficients for fractional delay reads.
+//
+// Each of the numPhases + 1 rows holds numTaps coefficients for a fractional
+// position of row / numPhases, covering buffer points current - 7 to current + 8.
+// Rows are normalised to unity gain at DC, and positions between rows are
+// interpolated linearly.
+class SincInterpolationTable
+{
+public:
+	static constexpr int numTaps = MAX_INTERPOLATION_POINTS;
+	static constexpr int numPhases = 256;
+
+	// Calculate coefficients, only doing the work the first time it is called
+	void build()
+	{
+		if (mCoefficients != nullptr)
+			return;
+
+		mCoefficients.malloc((size_t)((numPhases + 1) * numTaps));
+
+		// Cut off slightly below Nyquist to keep the windowed kernel's transition band out of the passband edge
+		const double cutoff = 0.95;
+
+		for (int phase = 0; phase <= numPhases; phase++)
+		{
+			float* row = mCoefficients + phase * numTaps;
+			double sum = 0;
+
+			for (int tap = 0; tap < numTaps; tap++)
+			{
+				// Distance of this tap from the read position
+				double x = (tap - (numTaps / 2 - 1)) - (double)phase / numPhases;
+				double sinc = (x == 0) ? 1.0 : std::sin(double_Pi * cutoff * x) / (double_Pi * cutoff * x);
+
+				// Blackman window spanning the full width of the taps
+				double u = (x + numTaps / 2) / numTaps;
+				double window = 0.42 - 0.5 * std::cos(2 * double_Pi * u) + 0.08 * std::cos(4 * double_Pi * u);
+
+				row[tap] = (float)(sinc * window);
+				sum += row[tap];
+			}
+
+			for (int tap = 0; tap < numTaps; tap++)
+				row[tap] = (float)(row[tap] / sum);
+		}
+	}
+
+	const float* getCoefficients() const noexcept { return mCoefficients; }
+
+private:
+	HeapBlock<float> mCoefficients;
+};
+
+//==============================================================================
+// Read a fractional position from a power-of-two circular buffer of float or double samples.
+// readHead must be non-negative, and mask is the buffer length minus one. Samples are stride
+// apart, so one channel can be read from a buffer of interleaved frames.
+template <int mode, typename SampleType>
+inline SampleType interpolateDelayBuffer(const SampleType* buffer, int mask, int stride, SampleType readHead, const float* sincCoefficients) noexcept
+{
+	auto fraction = readHead - (int)readHead;
+	auto current = (int)readHead & mask;
+
+	if (mode == linearInterpolation)
+	{
+		auto next = (current + 1) & mask;
+
+		return (1 - fraction) * buffer[current * stride] + fraction * buffer[next * stride];
+	}
+	else if (mode == hermiteInterpolation)
+	{
+		// 4-point, 3rd-order Hermite (Catmull-Rom)
+		auto ym1 = buffer[((current - 1) & mask) * stride];
+		auto y0 = buffer[current * stride];
+		auto y1 = buffer[((current + 1) & mask) * stride];
+		auto y2 = buffer[((current + 2) & mask) * stride];
+
+		auto c1 = 0.5f * (y1 - ym1);
+		auto c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+		auto c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+
+		return ((c3 * fraction + c2) * fraction + c1) * fraction + y0;
+	}
+	else if (mode == lagrange4Interpolation)
+	{
+		// 4-point Lagrange through points -1 to 2
+		auto ym1 = buffer[((current - 1) & mask) * stride];
+		auto y0 = buffer[current * stride];
+		auto y1 = buffer[((current + 1) & mask) * stride];
+		auto y2 = buffer[((current + 2) & mask) * stride];
+
+		auto dm1 = fraction + 1;
+		auto d1 = fraction - 1;
+		auto d2 = fraction - 2;
+
+		return -fraction * d1 * d2 * (SampleType(1) / 6) * ym1
+			+ dm1 * d1 * d2 * 0.5f * y0
+			- dm1 * fraction * d2 * 0.5f * y1
+			+ dm1 * fraction * d1 * (SampleType(1) / 6) * y2;
+	}
+	else if (mode == lagrange6Interpolation)
+	{
+		// 6-point Lagrange through points -2 to 3
+		auto ym2 = buffer[((current - 2) & mask) * stride];
+		auto ym1 = buffer[((current - 1) & mask) * stride];
+		auto y0 = buffer[current * stride];
+		auto y1 = buffer[((current + 1) & mask) * stride];
+		auto y2 = buffer[((current + 2) & mask) * stride];
+		auto y3 = buffer[((current + 3) & mask) * stride];
+
+		auto dm2 = fraction + 2;
+		auto dm1 = fraction + 1;
+		auto d1 = fraction - 1;
+		auto d2 = fraction - 2;
+		auto d3 = fraction - 3;
+
+		// Shared products of the distances to the outer points
+		auto outerBelow = dm2 * dm1;
+		auto outerAbove = d2 * d3;
+
+		return dm1 * fraction * d1 * outerAbove * (SampleType(-1) / 120) * ym2
+			+ dm2 * fraction * d1 * outerAbove * (SampleType(1) / 24) * ym1
+			+ outerBelow * d1 * outerAbove * (SampleType(-1) / 12) * y0
+			+ outerBelow * fraction * outerAbove * (SampleType(1) / 12) * y1
+			+ outerBelow * fraction * d1 * d3 * (SampleType(-1) / 24) * y2
+			+ outerBelow * fraction * d1 * d2 * (SampleType(1) / 120) * y3;
+	}
+	else
+	{
+		// Polyphase windowed sinc, interpolating between adjacent coefficient rows
+		auto position = fraction * SincInterpolationTable::numPhases;
+		auto phase = (int)position;
+		auto phaseFraction = position - phase;
+
+		const float* row = sincCoefficients + phase * SincInterpolationTable::numTaps;
+		const float* nextRow = row + SincInterpolationTable::numTaps;
+		const int first = current - (SincInterpolationTable::numTaps / 2 - 1);
+
+		SampleType result = 0;
+
+		for (int tap = 0; tap < SincInterpolationTable::numTaps; tap++)
+		{
+			auto coefficient = row[tap] + phaseFraction * (nextRow[tap] - row[tap]);
+			result += coefficient * buffer[((first + tap) & mask) * stride];
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Most threads, the calling thread included, that share a block's channels while rendering offline
+#define MAX_OFFLINE_THREADS 8
+
+//==============================================================================
+// Small pool of worker threads that runs numbered tasks alongside the calling thread.
+//
+// run hands out task indices from a shared counter to the calling thread and every worker,
+// and only returns once every worker has finished, so everything the tasks wrote is visible
+// to the caller afterwards. Which thread runs which task is not fixed, so a task must only
+// write results of its own, and the caller combines them in task order to get the same
+// result every time.
+//
+// Tasks arrive once per processing segment while a block renders, so idle workers spin
+// and yield for a while before they sleep, and nothing is allocated or locked after prepare.
+class OfflineWorkerPool
+{
+public:
+	OfflineWorkerPool() = default;
+
+	~OfflineWorkerPool()
+	{
+		release();
+	}
+
+	// Start numThreads - 1 workers, stopping any already running first
+	void prepare(int numThreads)
+	{
+		release();
+
+		const uint32 generation = mGeneration.load(std::memory_order_relaxed);
+
+		for (int thread = 1; thread < numThreads; thread++)
+			mWorkers.add(new Worker(*this, thread, generation))->startThread();
+	}
+
+	// Stop every worker
+	void release()
+	{
+		mWorkers.clear();
+	}
+
+	// Number of threads that run tasks, including the calling thread
+	int getNumThreads() const noexcept { return mWorkers.size() + 1; }
+
+	// Call task(taskIndex, threadIndex) for every taskIndex from 0 to numTasks - 1, and wait for all of them.
+	// threadIndex is 0 on the calling thread and counts up from 1 on the workers, below getNumThreads().
+	template <typename Task>
+	void run(int numTasks, Task& task) noexcept
+	{
+		mTask = &task;
+		mInvokeTask = [](void* context, int taskIndex, int threadIndex) { (*static_cast<Task*>(context))(taskIndex, threadIndex); };
+		mNumTasks = numTasks;
+		mNextTask.store(0, std::memory_order_relaxed);
+		mNumWorkersFinished.store(0, std::memory_order_relaxed);
+
+		// Publish the task to the workers, waking any that have gone to sleep
+		mGeneration.fetch_add(1, std::memory_order_release);
+
+		for (auto* worker : mWorkers)
+			worker->notify();
+
+		runTasks(0);
+
+		// Workers that find no tasks left still check in, so none of them can be caught up in the next call
+		for (int spins = 0; mNumWorkersFinished.load(std::memory_order_acquire) < mWorkers.size(); spins++)
+			if (spins >= numBusySpins)
+				Thread::yield();
+	}
+
+private:
+	// Checks of the generation made back to back, and then between yields, before an idle worker sleeps
+	static constexpr int numBusySpins = 1 << 10;
+	static constexpr int numYieldingSpins = 1 << 12;
+
+	class Worker : public Thread
+	{
+	public:
+		Worker(OfflineWorkerPool& pool, int threadIndex, uint32 generation)
+			: Thread("Offline worker " + String(threadIndex)), mPool(pool), mThreadIndex(threadIndex), mGeneration(generation)
+		{
+		}
+
+		~Worker()
+		{
+			signalThreadShouldExit();
+			notify();
+			stopThread(1000);
+		}
+
+		void run() override
+		{
+			while (waitForTasks())
+			{
+				mPool.runTasks(mThreadIndex);
+				mPool.mNumWorkersFinished.fetch_add(1, std::memory_order_release);
+			}
+		}
+
+	private:
+		// Wait for the next call to run, returning false if the thread should exit instead
+		bool waitForTasks()
+		{
+			for (int spins = 0; ! threadShouldExit(); spins++)
+			{
+				const uint32 generation = mPool.mGeneration.load(std::memory_order_acquire);
+
+				if (generation != mGeneration)
+				{
+					mGeneration = generation;
+					return true;
+				}
+
+				// Notifications are remembered, so one sent after the check above still wakes the thread
+				if (spins >= numBusySpins + numYieldingSpins)
+					wait(-1);
+				else if (spins >= numBusySpins)
+					Thread::yield();
+			}
+
+			return false;
+		}
+
+		OfflineWorkerPool& mPool;
+		const int mThreadIndex;
+		uint32 mGeneration;
+	};
+
+	// Run tasks until none are left
+	void runTasks(int threadIndex) noexcept
+	{
+		for (int taskIndex = mNextTask.fetch_add(1, std::memory_order_relaxed); taskIndex < mNumTasks;
+			 taskIndex = mNextTask.fetch_add(1, std::memory_order_relaxed))
+		{
+			mInvokeTask(mTask, taskIndex, threadIndex);
+		}
+	}
+
+	OwnedArray<Worker> mWorkers;
+
+	// Current task, written by the calling thread before each generation is published
+	void* mTask = nullptr;
+	void (*mInvokeTask)(void*, int, int) = nullptr;
+	int mNumTasks = 0;
+
+	std::atomic<uint32> mGeneration { 0 };
+	std::atomic<int> mNextTask { 0 };
+	std::atomic<int> mNumWorkersFinished { 0 };
+
+	JUCE_DECLARE_NON_COPYABLE(OfflineWorkerPool)
+};
@@ -0,0 +1,320 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Highest oversampling factor, reached with two cascaded half-band stages
+#define MAX_OVERSAMPLING_FACTOR 4
+
+//==============================================================================
+// Kaiser-windowed coefficients of a half-band FIR's non-zero polyphase branch, in float or double precision.
+//
+// Coefficients only depend on the number of taps and the stopband attenuation, so one set can
+// be shared by every filter of the same design.
+template <typename SampleType>
+class HalfBandCoefficients
+{
+public:
+	// numTaps must be of the form 4k + 3
+	void build(int numTaps, double stopbandAttenuation)
+	{
+		jassert(numTaps % 4 == 3);
+
+		const int branchLength = (numTaps + 1) / 2;
+		mCoefficients.malloc((size_t)(branchLength / 2));
+		mNumTaps = numTaps;
+
+		// Kaiser window parameter for the requested stopband attenuation in dB
+		const double beta = 0.1102 * (stopbandAttenuation - 8.7);
+		const int centre = (numTaps - 1) / 2;
+
+		// Calculate the first half of the non-zero branch, which holds every even tap
+		double sum = 0;
+
+		for (int pair = 0; pair < branchLength / 2; pair++)
+		{
+			int n = 2 * pair - centre;
+			double sinc = std::sin(double_Pi * n * 0.5) / (double_Pi * n);
+			double ratio = (double)n / centre;
+			double window = besselI0(beta * std::sqrt(1 - ratio * ratio)) / besselI0(beta);
+
+			mCoefficients[pair] = (SampleType)(sinc * window);
+			sum += 2 * mCoefficients[pair];
+		}
+
+		// Normalise the branch to match the centre tap, so both polyphase outputs have unity gain at DC
+		for (int pair = 0; pair < branchLength / 2; pair++)
+			mCoefficients[pair] = (SampleType)(mCoefficients[pair] * 0.5 / sum);
+	}
+
+	int getNumTaps() const noexcept { return mNumTaps; }
+	const SampleType* getData() const noexcept { return mCoefficients; }
+
+private:
+	// Zeroth order modified Bessel function of the first kind, used by the Kaiser window
+	static double besselI0(double x)
+	{
+		double sum = 1, term = 1;
+
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	int mNumTaps = 0;
+	HeapBlock<SampleType> mCoefficients;
+};
+
+//==============================================================================
+// Linear-phase half-band FIR that doubles or halves the sample rate of one channel at a time,
+// in float or double precision.
+//
+// A half-band filter of 4k + 3 taps has zeros at every other tap apart from the centre,
+// so it is run as two polyphase branches at the lower rate: one holding the k + 1
+// symmetric pairs of non-zero taps, the other a plain delay through the centre tap.
+// Upsampling followed by downsampling delays the signal by numTaps - 1 samples at the
+// higher rate. The coefficients are not owned by the filter.
+template <typename SampleType>
+class HalfBandFilter
+{
+public:
+	// numTaps must be of the form 4k + 3
+	HalfBandFilter(int numTaps)
+		: mNumTaps(numTaps), mBranchLength((numTaps + 1) / 2), mCentreDelay((numTaps - 3) / 4)
+	{
+		jassert(numTaps % 4 == 3);
+	}
+
+	// Make room for filter history for each channel and use coefficients built for this filter's number of taps,
+	// which must outlive it. Storage is only reallocated when there are more channels than before.
+	void prepare(int numChannels, const HalfBandCoefficients<SampleType>& coefficients)
+	{
+		jassert(coefficients.getNumTaps() == mNumTaps);
+		mCoefficients = coefficients.getData();
+
+		// Histories are stored twice over so the most recent samples are always contiguous
+		mUpsampleHistory.setSize(numChannels, 2 * mBranchLength, false, false, true);
+		mDownsampleEvenHistory.setSize(numChannels, 2 * mBranchLength, false, false, true);
+		mDownsampleOddHistory.setSize(numChannels, 2 * (mCentreDelay + 2), false, false, true);
+
+		if (numChannels > mNumChannelsAllocated)
+		{
+			mUpsamplePosition.malloc((size_t)numChannels);
+			mDownsampleEvenPosition.malloc((size_t)numChannels);
+			mDownsampleOddPosition.malloc((size_t)numChannels);
+			mNumChannelsAllocated = numChannels;
+		}
+
+		mNumChannels = numChannels;
+		reset();
+	}
+
+	// Clear filter history
+	void reset()
+	{
+		mUpsampleHistory.clear();
+		mDownsampleEvenHistory.clear();
+		mDownsampleOddHistory.clear();
+
+		for (int channel = 0; channel < mNumChannels; channel++)
+			mUpsamplePosition[channel] = mDownsampleEvenPosition[channel] = mDownsampleOddPosition[channel] = 0;
+	}
+
+	// Delay of upsampling followed by downsampling, in samples at the higher rate
+	int getLatency() const noexcept { return mNumTaps - 1; }
+
+	// Write 2 * numSamples samples to output from numSamples samples of input
+	void upsample(const SampleType* input, SampleType* output, int channel, int numSamples) noexcept
+	{
+		SampleType* history = mUpsampleHistory.getWritePointer(channel);
+		int position = mUpsamplePosition[channel];
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			const SampleType* recent = push(history, position, mBranchLength, input[i]);
+
+			// Zero-stuffing halves the gain, so the non-zero branch is doubled and the centre tap of 0.5 becomes 1
+			output[2 * i] = 2 * applyBranch(recent);
+			output[2 * i + 1] = recent[mCentreDelay];
+		}
+
+		mUpsamplePosition[channel] = position;
+	}
+
+	// Write numSamples samples to output from 2 * numSamples samples of input
+	void downsample(const SampleType* input, SampleType* output, int channel, int numSamples) noexcept
+	{
+		SampleType* evenHistory = mDownsampleEvenHistory.getWritePointer(channel);
+		SampleType* oddHistory = mDownsampleOddHistory.getWritePointer(channel);
+		int evenPosition = mDownsampleEvenPosition[channel];
+		int oddPosition = mDownsampleOddPosition[channel];
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			const SampleType* recentEven = push(evenHistory, evenPosition, mBranchLength, input[2 * i]);
+			const SampleType* recentOdd = push(oddHistory, oddPosition, mCentreDelay + 2, input[2 * i + 1]);
+
+			output[i] = applyBranch(recentEven) + (SampleType)0.5 * recentOdd[mCentreDelay + 1];
+		}
+
+		mDownsampleEvenPosition[channel] = evenPosition;
+		mDownsampleOddPosition[channel] = oddPosition;
+	}
+
+private:
+	// Add a sample to a doubled history line, returning the line with the newest sample first
+	static const SampleType* push(SampleType* history, int& position, int length, SampleType sample) noexcept
+	{
+		position = (position == 0 ? length : position) - 1;
+		history[position] = history[position + length] = sample;
+
+		return history + position;
+	}
+
+	// Run the non-zero polyphase branch, adding each symmetric pair before multiplying
+	SampleType applyBranch(const SampleType* recent) const noexcept
+	{
+		SampleType sum = 0;
+
+		for (int pair = 0; pair < mBranchLength / 2; pair++)
+			sum += mCoefficients[pair] * (recent[pair] + recent[mBranchLength - 1 - pair]);
+
+		return sum;
+	}
+
+	int mNumTaps, mBranchLength, mCentreDelay;
+	const SampleType* mCoefficients = nullptr;
+	int mNumChannels = 0, mNumChannelsAllocated = 0;
+
+	AudioBuffer<SampleType> mUpsampleHistory, mDownsampleEvenHistory, mDownsampleOddHistory;
+	HeapBlock<int> mUpsamplePosition, mDownsampleEvenPosition, mDownsampleOddPosition;
+};
+
+//==============================================================================
+// 2x or 4x oversampling for one channel at a time, built from cascaded half-band stages.
+// Calls for different channels touch no shared state, so they may run on different threads.
+//
+// The first stage carries the full audio band and needs a steep transition; the second
+// only has to reject images far above the first stage's passband, so it is much shorter.
+// The second stage's output is delayed by one sample at twice the base rate so the total
+// latency is a whole number of base rate samples.
+template <typename SampleType>
+class Oversampler
+{
+public:
+	// Design of each stage, used to build the coefficients passed to prepare
+	static constexpr int firstStageNumTaps = 63;
+	static constexpr int secondStageNumTaps = 23;
+	static constexpr double stopbandAttenuation = 80.0;
+
+	Oversampler()
+		: mFirstStage(firstStageNumTaps), mSecondStage(secondStageNumTaps), mFactor(1)
+	{
+	}
+
+	// Make room for filter history and intermediate buffers for blocks of up to maximumBlockSize base rate samples, filtering with
+	// coefficients that must outlive the oversampler. Storage is only reallocated when it needs to grow.
+	void prepare(int numChannels, int maximumBlockSize, const HalfBandCoefficients<SampleType>& firstStageCoefficients,
+				 const HalfBandCoefficients<SampleType>& secondStageCoefficients)
+	{
+		mFirstStage.prepare(numChannels, firstStageCoefficients);
+		mSecondStage.prepare(numChannels, secondStageCoefficients);
+
+		mIntermediateBuffer.setSize(numChannels, 2 * maximumBlockSize, false, false, true);
+
+		if (numChannels > mNumChannelsAllocated)
+		{
+			mAlignmentDelay.malloc((size_t)numChannels);
+			mNumChannelsAllocated = numChannels;
+		}
+
+		mNumChannels = numChannels;
+		reset();
+	}
+
+	// Set the oversampling factor (1, 2 or 4) and clear filter history
+	void setFactor(int factor)
+	{
+		mFactor = factor;
+		reset();
+	}
+
+	// Clear filter history
+	void reset()
+	{
+		mFirstStage.reset();
+		mSecondStage.reset();
+
+		for (int channel = 0; channel < mNumChannels; channel++)
+			mAlignmentDelay[channel] = 0;
+	}
+
+	int getFactor() const noexcept { return mFactor; }
+
+	// Delay of upsampling followed by downsampling, in base rate samples
+	int getLatencySamples() const noexcept
+	{
+		if (mFactor == 2)
+			return mFirstStage.getLatency() / 2;
+
+		if (mFactor == 4)
+			return mFirstStage.getLatency() / 2 + (mSecondStage.getLatency() + 2) / 4;
+
+		return 0;
+	}
+
+	// Write numSamples * factor samples to output from numSamples samples of input
+	void upsample(const SampleType* input, SampleType* output, int channel, int numSamples) noexcept
+	{
+		if (mFactor == 2)
+		{
+			mFirstStage.upsample(input, output, channel, numSamples);
+		}
+		else
+		{
+			SampleType* intermediate = mIntermediateBuffer.getWritePointer(channel);
+
+			mFirstStage.upsample(input, intermediate, channel, numSamples);
+			mSecondStage.upsample(intermediate, output, channel, 2 * numSamples);
+		}
+	}
+
+	// Write numSamples samples to output from numSamples * factor samples of input
+	void downsample(const SampleType* input, SampleType* output, int channel, int numSamples) noexcept
+	{
+		if (mFactor == 2)
+		{
+			mFirstStage.downsample(input, output, channel, numSamples);
+		}
+		else
+		{
+			SampleType* intermediate = mIntermediateBuffer.getWritePointer(channel);
+
+			mSecondStage.downsample(input, intermediate, channel, 2 * numSamples);
+
+			// Align the second stage's half sample of latency to a whole base rate sample
+			SampleType delayed = mAlignmentDelay[channel];
+
+			for (int i = 0; i < 2 * numSamples; i++)
+				std::swap(delayed, intermediate[i]);
+
+			mAlignmentDelay[channel] = delayed;
+
+			mFirstStage.downsample(intermediate, output, channel, numSamples);
+		}
+	}
+
+private:
+	HalfBandFilter<SampleType> mFirstStage, mSecondStage;
+	int mFactor;
+	int mNumChannels = 0, mNumChannelsAllocated = 0;
+
+	// Second stage input and output for each channel, so different channels can be processed on different threads
+	AudioBuffer<SampleType> mIntermediateBuffer;
+
+	// Previous second stage output for each channel
+	HeapBlock<SampleType> mAlignmentDelay;
+};
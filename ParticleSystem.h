@@ -0,0 +1,151 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Time allowed for painting particles in one frame, in milliseconds
+#define PARTICLE_PAINT_BUDGET 4.0
+
+//==============================================================================
+// Pool of expanding, fading rings for the editor animation, stored as one array per field.
+//
+// Live particles are packed at the front of the arrays: spawning appends, and removing a
+// particle moves the last live particle into its place, so nothing is allocated after
+// construction. The number of live particles is capped, and the cap adapts so painting
+// stays within PARTICLE_PAINT_BUDGET each frame.
+class ParticleSystem
+{
+public:
+	static constexpr int maxParticles = 512;
+
+	ParticleSystem()
+	{
+		mX.malloc(maxParticles);
+		mY.malloc(maxParticles);
+		mSize.malloc(maxParticles);
+		mOpacity.malloc(maxParticles);
+		mThickness.malloc(maxParticles);
+		mLimit.malloc(maxParticles);
+	}
+
+	// Add a ring with its top left corner at x, y, to be removed once x has moved to limit.
+	// Invisible rings, and rings beyond the current cap, are not added.
+	void spawn(float x, float y, float size, float opacity, float thickness, float limit) noexcept
+	{
+		if (mNumParticles >= mCapacity || opacity <= 0 || thickness <= 0)
+			return;
+
+		mX[mNumParticles] = x;
+		mY[mNumParticles] = y;
+		mSize[mNumParticles] = size;
+		mOpacity[mNumParticles] = jmin(1.0f, opacity);
+		mThickness[mNumParticles] = thickness;
+		mLimit[mNumParticles] = limit;
+		mNumParticles++;
+	}
+
+	// Grow, move and fade every particle by a number of animation steps in a single pass, removing
+	// those that have moved past their limit or faded out. Returns the area that needs repainting,
+	// covering every particle before and after the update.
+	Rectangle<int> update(int numSteps) noexcept
+	{
+		const float steps = (float)numSteps;
+
+		float left = std::numeric_limits<float>::max(), top = left;
+		float right = std::numeric_limits<float>::lowest(), bottom = right;
+
+		int i = 0;
+
+		while (i < mNumParticles)
+		{
+			// Half of the outline's thickness lies outside the ring, plus a pixel for anti-aliasing
+			float margin = mThickness[i] / 2 + 1;
+			float x = mX[i] - margin, y = mY[i] - margin, extent = mSize[i] + 2 * margin;
+
+			// Expand about the centre while fading and thinning out
+			mX[i] -= 5 * steps;
+			mY[i] -= 5 * steps;
+			mSize[i] += 10 * steps;
+			mOpacity[i] -= 0.010f * steps;
+			mThickness[i] -= 0.025f * steps;
+
+			// Rings grow faster than their outlines thin, so the new bounds contain the old ones
+			// and only a removed particle's last bounds need adding separately
+			const bool isAlive = mX[i] > mLimit[i] && mOpacity[i] > 0 && mThickness[i] > 0;
+
+			if (isAlive)
+			{
+				margin = mThickness[i] / 2 + 1;
+				x = mX[i] - margin;
+				y = mY[i] - margin;
+				extent = mSize[i] + 2 * margin;
+			}
+
+			left = jmin(left, x);
+			top = jmin(top, y);
+			right = jmax(right, x + extent);
+			bottom = jmax(bottom, y + extent);
+
+			if (! isAlive)
+			{
+				// Move the last live particle into this slot and update it next
+				remove(i);
+				continue;
+			}
+
+			i++;
+		}
+
+		if (left > right)
+			return {};
+
+		return Rectangle<float>::leftTopRightBottom(left, top, right, bottom).getSmallestIntegerContainer();
+	}
+
+	// Draw every particle, then adjust the cap so the next frame's painting stays within the budget
+	void paint(Graphics& g, Colour colour)
+	{
+		const double startTime = Time::getMillisecondCounterHiRes();
+
+		g.setColour(colour);
+
+		for (int i = 0; i < mNumParticles; i++)
+		{
+			g.setOpacity(mOpacity[i]);
+			g.drawEllipse(mX[i], mY[i], mSize[i], mSize[i], mThickness[i]);
+		}
+
+		updateCapacity(Time::getMillisecondCounterHiRes() - startTime);
+	}
+
+	int getNumParticles() const noexcept { return mNumParticles; }
+
+private:
+	void remove(int index) noexcept
+	{
+		mNumParticles--;
+
+		mX[index] = mX[mNumParticles];
+		mY[index] = mY[mNumParticles];
+		mSize[index] = mSize[mNumParticles];
+		mOpacity[index] = mOpacity[mNumParticles];
+		mThickness[index] = mThickness[mNumParticles];
+		mLimit[index] = mLimit[mNumParticles];
+	}
+
+	// Cut the cap quickly when painting runs over budget, and raise it slowly while there is time to spare
+	void updateCapacity(double paintTime) noexcept
+	{
+		if (paintTime > PARTICLE_PAINT_BUDGET)
+			mCapacity = jmax(minCapacity, mCapacity * 3 / 4);
+		else if (paintTime < PARTICLE_PAINT_BUDGET / 2 && mNumParticles >= mCapacity)
+			mCapacity = jmin(maxParticles, mCapacity + 8);
+	}
+
+	// Fewest particles allowed however slow painting is
+	static constexpr int minCapacity = 16;
+
+	HeapBlock<float> mX, mY, mSize, mOpacity, mThickness, mLimit;
+
+	int mNumParticles = 0;
+	int mCapacity = maxParticles;
+};
@@ -8,8 +8,14 @@ ChorusFlangerAudioProcessorEditor::ChorusFlangerAudioProcessorEditor(ChorusFlang
 	// Set size of plugin window
 	setSize(500, 400);
 
-	// Initialize timer rate
-	mTimerRate = 0;
+	// Background is drawn over the whole editor, so nothing behind it needs painting
+	setOpaque(true);
+
+	// Initialize animation state
+	mAnimationSteps = 0;
+	mLastFrameTime = Time::getMillisecondCounterHiRes();
+	mBackgroundType = -1;
+	mBackgroundScale = 0;
 
 	// Retrieve reference to plugin parameters
 	auto& params = processor.getParameters();
@@ -50,13 +56,8 @@ ChorusFlangerAudioProcessorEditor::ChorusFlangerAudioProcessorEditor(ChorusFlang
 	{
 		*rateParameter = mRateSlider.getValue();
 
-		// Set timer rate and start new timer for repaint callback function
-		mTimerRate = (int)((mRateSlider.getValue()) * 5);
-
-		if (mTimerRate < 5)
-			mTimerRate = 5;
-
-		startTimerHz(mTimerRate);
+		// Set animation rate
+		mAnimationRate = jmax(5.0f, (float)mRateSlider.getValue() * 5);
 	};
 	mRateSlider.onDragStart = [rateParameter] {rateParameter->beginChangeGesture(); };
 	mRateSlider.onDragEnd = [rateParameter] {rateParameter->endChangeGesture(); };
@@ -98,26 +99,99 @@ ChorusFlangerAudioProcessorEditor::ChorusFlangerAudioProcessorEditor(ChorusFlang
 		typeParameter->beginChangeGesture();
 		*typeParameter = mType.getSelectedItemIndex();
 		typeParameter->endChangeGesture();
+
+		// Redraw the title
+		repaint();
 	};
 
 
-	// Initialize set of Ellipses
-	ellipses = new Ellipse[8];
+	// Set pointer to Voices parameter
+	AudioParameterInt* voicesParameter = (AudioParameterInt*)params.getUnchecked(6);
+
+	// Set Voices combo box
+	mVoices.setBounds(400, 40, 100, 20);
+
+	for (int voices = 1; voices <= MAX_VOICES; voices++)
+		mVoices.addItem(String(voices) + (voices == 1 ? " Voice" : " Voices"), voices);
 
-	Ellipse ellipseAssignment[8] = { mEllipse1, mEllipse2, mEllipse3, mEllipse4, mEllipseLeft, mEllipseRight, mEllipseF1, mEllipseF2 };
-	Type ellipseTypes[8] = { normal, normal, normal, normal, left, right, feedback1, feedback2 };
-	int ellipseCounters[8] = { 0, 20, 40, 60, 0, 0, 10, 30 };
+	mVoices.setSelectedId(*voicesParameter, dontSendNotification);
+	addAndMakeVisible(mVoices);
 
-	for (int i = 0; i < 8; i++)
+	// Define combo box functionality
+	mVoices.onChange = [this, voicesParameter]
 	{
-		ellipses[i] = ellipseAssignment[i];
-		ellipses[i].type = ellipseTypes[i];
-		ellipses[i].counter = ellipseCounters[i];
-		ellipses[i].offset = 0;
-		ellipses[i].boundsFlag = true;
-	}
+		voicesParameter->beginChangeGesture();
+		*voicesParameter = mVoices.getSelectedId();
+		voicesParameter->endChangeGesture();
+	};
+
+
+	// Set pointer to Interpolation parameter
+	AudioParameterChoice* interpolationParameter = (AudioParameterChoice*)params.getUnchecked(7);
+
+	// Set Interpolation combo box
+	mInterpolation.setBounds(400, 70, 100, 20);
+	mInterpolation.addItemList(interpolationParameter->choices, 1);
+	mInterpolation.setSelectedItemIndex(interpolationParameter->getIndex(), dontSendNotification);
+	addAndMakeVisible(mInterpolation);
+
+	// Define combo box functionality
+	mInterpolation.onChange = [this, interpolationParameter]
+	{
+		interpolationParameter->beginChangeGesture();
+		*interpolationParameter = mInterpolation.getSelectedItemIndex();
+		interpolationParameter->endChangeGesture();
+	};
+
+
+	// Set pointer to Oversampling parameter
+	AudioParameterChoice* oversamplingParameter = (AudioParameterChoice*)params.getUnchecked(8);
+
+	// Set Oversampling combo box
+	mOversampling.setBounds(400, 100, 100, 20);
+	mOversampling.addItemList(oversamplingParameter->choices, 1);
+	mOversampling.setSelectedItemIndex(oversamplingParameter->getIndex(), dontSendNotification);
+	addAndMakeVisible(mOversampling);
+
+	// Define combo box functionality
+	mOversampling.onChange = [this, oversamplingParameter]
+	{
+		oversamplingParameter->beginChangeGesture();
+		*oversamplingParameter = mOversampling.getSelectedItemIndex();
+		oversamplingParameter->endChangeGesture();
+	};
 
-	resetEllipses(ellipses);
+
+	// Set pointer to Sync parameter
+	AudioParameterChoice* syncParameter = (AudioParameterChoice*)params.getUnchecked(9);
+
+	// Set Sync combo box
+	mSync.setBounds(400, 130, 100, 20);
+	mSync.addItemList(syncParameter->choices, 1);
+	mSync.setSelectedItemIndex(syncParameter->getIndex(), dontSendNotification);
+	addAndMakeVisible(mSync);
+
+	// Rate has no effect while the LFO follows the host tempo
+	mRateSlider.setEnabled(syncParameter->getIndex() == 0);
+
+	// Define combo box functionality
+	mSync.onChange = [this, syncParameter]
+	{
+		syncParameter->beginChangeGesture();
+		*syncParameter = mSync.getSelectedItemIndex();
+		syncParameter->endChangeGesture();
+
+		mRateSlider.setEnabled(mSync.getSelectedItemIndex() == 0);
+	};
+
+
+	// Initialize ring emission
+	mAnimationStep = 0;
+	mFeedbackParticlesDue = 0;
+
+	// Set animation rate, and draw frames at a fixed rate however fast the animation runs
+	mAnimationRate = jmax(5.0f, (float)mRateSlider.getValue() * 5);
+	startTimerHz(ANIMATION_FRAME_RATE);
 }
 
 ChorusFlangerAudioProcessorEditor::~ChorusFlangerAudioProcessorEditor()
@@ -127,19 +201,88 @@ ChorusFlangerAudioProcessorEditor::~ChorusFlangerAudioProcessorEditor()
 //==============================================================================
 void ChorusFlangerAudioProcessorEditor::paint (Graphics& g)
 {
-	drawGUI(g);
-	animateGUI(ellipses, g);
+	// Render the background again if the title has changed or the editor has moved to a display with a different scale
+	float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+	if (mBackground.isNull() || mBackgroundType != mType.getSelectedItemIndex() || mBackgroundScale != scale)
+		renderBackground(scale);
+
+	g.drawImage(mBackground, getLocalBounds().toFloat());
+	mParticles.paint(g, Colour(0xff22f07f));
+
+   #if CHORUSFLANGER_ENABLE_PROFILING
+	paintProfiler(g);
+   #endif
 }
 
 void ChorusFlangerAudioProcessorEditor::timerCallback()
 {
-	repaint();
+	// Keep the previous measurements if the audio thread has not processed a block since the last frame
+	processor.popTelemetry(mTelemetry);
+
+	updateControls();
+
+   #if CHORUSFLANGER_ENABLE_PROFILING
+	// Refresh the CPU load display four times a second
+	if (++mProfilerFrameCount >= ANIMATION_FRAME_RATE / 4)
+	{
+		mProfilerFrameCount = 0;
+		repaint(getProfilerBounds());
+	}
+   #endif
+
+	// Work out how many animation steps are due from the time since the last frame. After a stall,
+	// skip ahead instead of catching up on every missed step.
+	double now = Time::getMillisecondCounterHiRes();
+	mAnimationSteps += jmin(0.1, (now - mLastFrameTime) * 0.001) * mAnimationRate;
+	mLastFrameTime = now;
+
+	if (mAnimationSteps < 1)
+		return;
+
+	int numSteps = (int)mAnimationSteps;
+	mAnimationSteps -= numSteps;
+
+	// Emit new rings, then move every ring in one pass, repainting only where the rings were and where they have moved to
+	emitParticles(numSteps);
+
+	Rectangle<int> dirtyArea = mParticles.update(numSteps).getIntersection(getLocalBounds());
+
+	if (! dirtyArea.isEmpty())
+		repaint(dirtyArea);
 }
 
 void ChorusFlangerAudioProcessorEditor::resized()
 {
 }
 
+// Show parameter values changed by the host, automation or a program change. Sliders being dragged are left
+// alone, and no notifications are sent, so nothing is written back to the parameters.
+void ChorusFlangerAudioProcessorEditor::updateControls()
+{
+	auto& params = processor.getParameters();
+
+	Slider* sliders[] = { &mDryWetSlider, &mDepthSlider, &mRateSlider, &mPhaseOffsetSlider, &mFeedbackSlider };
+
+	for (int index = 0; index < numElementsInArray(sliders); index++)
+		if (! sliders[index]->isMouseButtonDown())
+			sliders[index]->setValue(*(AudioParameterFloat*)params.getUnchecked(index), dontSendNotification);
+
+	mType.setSelectedItemIndex((int)*(AudioParameterFloat*)params.getUnchecked(5), dontSendNotification);
+	mVoices.setSelectedId(*(AudioParameterInt*)params.getUnchecked(6), dontSendNotification);
+	mInterpolation.setSelectedItemIndex(((AudioParameterChoice*)params.getUnchecked(7))->getIndex(), dontSendNotification);
+	mOversampling.setSelectedItemIndex(((AudioParameterChoice*)params.getUnchecked(8))->getIndex(), dontSendNotification);
+	mSync.setSelectedItemIndex(((AudioParameterChoice*)params.getUnchecked(9))->getIndex(), dontSendNotification);
+
+	// Rate and the animation follow the knob and Sync as they would when set from the editor
+	mRateSlider.setEnabled(mSync.getSelectedItemIndex() == 0);
+	mAnimationRate = jmax(5.0f, (float)mRateSlider.getValue() * 5);
+
+	// Redraw the title if Type has changed
+	if (mBackgroundType != mType.getSelectedItemIndex())
+		repaint();
+}
+
 //=========================Self-Created Functions===============================
 void ChorusFlangerAudioProcessorEditor::setSlider(Slider& slider, Label& label, AudioParameterFloat* parameter, const String &name, Rectangle<int> bounds)
 {
@@ -174,126 +317,47 @@ void ChorusFlangerAudioProcessorEditor::setComboBox(ComboBox& comboBox, AudioPar
 	addAndMakeVisible(comboBox);
 }
 
-void ChorusFlangerAudioProcessorEditor::paintEllipses(Ellipse *ellipseArray, Graphics& g)
+void ChorusFlangerAudioProcessorEditor::emitParticles(int numSteps)
 {
-	// Setup color for ellipses
-	g.setColour(Colour(0xff22f07f));
+	// Map measured wet and feedback levels to opacity, scaled by how much of the wet signal is heard
+	float wetLevel = jmin(1.0f, mTelemetry.wetRMS * 4.0f) * (float)mDryWetSlider.getValue();
+	float feedbackLevel = jmin(1.0f, std::sqrt(mTelemetry.feedbackEnergy) * 4.0f) * (float)mDryWetSlider.getValue();
 
-	for (int i = 0; i < 8; i++)
-	{
-		if (ellipseArray[i].offset >= ellipseArray[i].counter)
-		{
-			// Draw ellipse
-			g.setOpacity(ellipseArray[i].opacity);
-			g.drawEllipse(ellipseArray[i].x, ellipseArray[i].y, ellipseArray[i].width, ellipseArray[i].height, ellipseArray[i].thickness);
-		}
-	}
-}
+	// Swell ring thickness with the LFO, by as much as the depth setting
+	float lfo = std::sin(2 * float_Pi * mTelemetry.lfoPhase);
+	float thickness = mDepthSlider.getValue() * 30.0f * (0.75f + 0.25f * lfo);
 
-void ChorusFlangerAudioProcessorEditor::updateEllipseLocations(Ellipse *ellipseArray)
-{
-	for (int i = 0; i < 8; i++)
+	// Stereo rings only appear with some phase offset
+	float stereoLevel = jmin(wetLevel, (float)mPhaseOffsetSlider.getValue());
+
+	int numVoices = jmax(1, mVoices.getSelectedId());
+
+	for (int step = 0; step < numSteps; step++, mAnimationStep++)
 	{
-		// Enforce ellipse offset
-		if (ellipseArray[i].offset >= ellipseArray[i].counter)
+		// A ring for each voice every 20 steps, each slightly wider than the last and leaving at the same time
+		if (mAnimationStep % 20 == 0)
 		{
-			ellipseArray[i].x -= 5;
-			ellipseArray[i].y -= 5;
-			ellipseArray[i].width += 10;
-			ellipseArray[i].height += 10;
-			ellipseArray[i].opacity -= 0.010;
-			if (ellipseArray[i].opacity <= 0)
-				ellipseArray[i].opacity = 0;
-			ellipseArray[i].thickness -= 0.025;
-	
-			switch (ellipseArray[i].type)
-			{
-			// Normal and feedback ellipse types
-			case 0:
-			case 3:
-			case 4:
-				if (ellipseArray[i].x <= -100)
-					ellipseArray[i].boundsFlag = true;
-				break;
-
-			// Left type
-			case 1:
-				if (ellipseArray[i].x <= -250)
-					ellipseArray[i].boundsFlag = true;
-				break;
-
-			// Right type
-			case 2:
-				if (ellipseArray[i].x <= 50)
-					ellipseArray[i].boundsFlag = true;
-				break;
-			}
+			for (int voice = 0; voice < numVoices; voice++)
+				mParticles.spawn(200.0f - 4 * voice, 150.0f - 4 * voice, 100.0f + 8 * voice, wetLevel, thickness, -100.0f - 4 * voice);
 		}
-	}
-}
 
-void ChorusFlangerAudioProcessorEditor::resetEllipses(Ellipse *ellipseArray)
-{
-	for (int i = 0; i < 8; i++)
-	{
-		// Once ellipse has gone off screen
-		if (ellipseArray[i].boundsFlag == true)
+		// Left and right rings every 60 steps
+		if (mAnimationStep % 60 == 0)
 		{
-			// Set ellipse dimensions
-			ellipseArray[i].y = 150;
-			ellipseArray[i].width = 100;
-			ellipseArray[i].height = 100;
-			ellipseArray[i].thickness = mDepthSlider.getValue() * 30.0f;
-
-			switch (ellipseArray[i].type)
-			{
-			// Normal type
-			case 0:
-				ellipseArray[i].x = 200;
-				ellipseArray[i].opacity = mDryWetSlider.getValue();
-				break;
-
-			// Left type
-			case 1:
-				ellipseArray[i].x = 50;
-				ellipseArray[i].opacity = (mDryWetSlider.getValue() <= mPhaseOffsetSlider.getValue()) ?
-					mDryWetSlider.getValue() : mPhaseOffsetSlider.getValue();
-				break;
-
-			// Right type
-			case 2:
-				ellipseArray[i].x = 350;
-				ellipseArray[i].opacity = (mDryWetSlider.getValue() <= mPhaseOffsetSlider.getValue()) ?
-					mDryWetSlider.getValue() : mPhaseOffsetSlider.getValue();
-				break;
-
-			// Feedback 1 type
-			case 3:
-				ellipseArray[i].x = 200;
-				ellipseArray[i].opacity = (mDryWetSlider.getValue() <= mFeedbackSlider.getValue()) ?
-					mDryWetSlider.getValue() : mFeedbackSlider.getValue();
-				break;
-			// Feedback 2 type
-			case 4:
-				ellipseArray[i].x = 200;
-				ellipseArray[i].opacity = (mDryWetSlider.getValue() <= mFeedbackSlider.getValue()) ?
-					mDryWetSlider.getValue() : mFeedbackSlider.getValue() / 2;
-				break;
-			}
-
-			// Reset bounds flag
-			ellipseArray[i].boundsFlag = false;
+			mParticles.spawn(50, 150, 100, stereoLevel, thickness, -250);
+			mParticles.spawn(350, 150, 100, stereoLevel, thickness, 50);
 		}
-	}
-}
 
-void ChorusFlangerAudioProcessorEditor::updateCounters(Ellipse *ellipseArray)
-{
-	for (int i = 0; i < 8; i++)
-	{
-		if (ellipseArray[i].offset <= ellipseArray[i].counter)
+		// A feedback ring between voice rings, plus a scattered cloud of fainter rings as dense as the feedback
+		if (mAnimationStep % 20 == 10)
+			mParticles.spawn(200, 150, 100, feedbackLevel, thickness, -100);
+
+		for (mFeedbackParticlesDue += feedbackLevel * 4; mFeedbackParticlesDue >= 1; mFeedbackParticlesDue -= 1)
 		{
-			ellipseArray[i].offset++;
+			float x = 200 + mRandom.nextFloat() * 40 - 20;
+			float y = 150 + mRandom.nextFloat() * 40 - 20;
+
+			mParticles.spawn(x, y, 100, feedbackLevel / 2, thickness / 2, x - 300);
 		}
 	}
 }
@@ -320,10 +384,51 @@ void ChorusFlangerAudioProcessorEditor::drawGUI(Graphics& g)
 	}
 }
 
-void ChorusFlangerAudioProcessorEditor::animateGUI(Ellipse *ellipseArray, Graphics& g)
+void ChorusFlangerAudioProcessorEditor::renderBackground(float scale)
+{
+	// Render at the display's pixel scale so the title stays sharp
+	mBackground = Image(Image::RGB, roundToInt(getWidth() * scale), roundToInt(getHeight() * scale), false);
+
+	Graphics g(mBackground);
+	g.addTransform(AffineTransform::scale(scale));
+	drawGUI(g);
+
+	mBackgroundType = mType.getSelectedItemIndex();
+	mBackgroundScale = scale;
+}
+
+#if CHORUSFLANGER_ENABLE_PROFILING
+void ChorusFlangerAudioProcessorEditor::paintProfiler(Graphics& g)
 {
-	updateCounters(ellipses);
-	paintEllipses(ellipses, g);
-	updateEllipseLocations(ellipses);
-	resetEllipses(ellipses);
-}
\ No newline at end of file
+	auto report = processor.getProfiler().getReport();
+	auto bounds = getProfilerBounds();
+	int x = bounds.getX() + 5, y = bounds.getY();
+
+	// Darken the animation behind the display
+	g.setColour(Colour(0xb0000000));
+	g.fillRect(bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight());
+
+	g.setColour(Colour(0xff99f7f0));
+	g.setFont(12.0f);
+	g.drawSingleLineText("CPU " + String(report.averageLoad * 100, 1) + "% avg, " + String(report.peakLoad * 100, 1) + "% peak", x, y + 14);
+
+	// Histogram of block loads from 0 to 100% and over, scaled to the fullest bin
+	uint32 maxCount = 1;
+
+	for (int bin = 0; bin < ProcessorProfiler::numLoadBins; bin++)
+		maxCount = jmax(maxCount, report.loadHistogram[bin]);
+
+	int barWidth = (bounds.getWidth() - 10) / ProcessorProfiler::numLoadBins;
+
+	for (int bin = 0; bin < ProcessorProfiler::numLoadBins; bin++)
+	{
+		int height = (int)(40.0f * report.loadHistogram[bin] / maxCount);
+		g.fillRect(x + bin * barWidth, y + 60 - height, barWidth - 1, height);
+	}
+
+	// Share of the real time budget spent in each stage
+	for (int stage = 0; stage < numProfileStages; stage++)
+		g.drawSingleLineText(String(ProcessorProfiler::getStageName(stage)) + ": " + String(report.stageLoad[stage] * 100, 2) + "%",
+							 x, y + 74 + stage * 11);
+}
+#endif
\ No newline at end of file
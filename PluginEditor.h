@@ -2,6 +2,10 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "ParticleSystem.h"
+
+// Frames per second for the animation, independent of the Rate knob
+#define ANIMATION_FRAME_RATE 60
 
 //==============================================================================
 class ChorusFlangerAudioProcessorEditor : public AudioProcessorEditor,
@@ -20,23 +24,16 @@ public:
 	void setSlider(Slider& slider, Label& label, AudioParameterFloat* parameter, const String &name, Rectangle<int> bounds);
 	void setComboBox(ComboBox& comboBox, AudioParameterFloat* parameter, const String &item1, const String &item2, Rectangle<int> bounds);
 
-	enum Type {normal, left, right, feedback1, feedback2};
-
-	struct Ellipse
-	{
-		float x, y, width, height, opacity, thickness;
-		Type type;
-		bool boundsFlag;
-		int offset, counter;
-	};
-
-	void updateEllipseLocations(Ellipse *ellipseArray);
-	void paintEllipses(Ellipse *ellipseArray, Graphics& g);
-	void resetEllipses(Ellipse *ellipseArray);
-	void updateCounters(Ellipse *ellipseArray);
+	void updateControls();
+	void emitParticles(int numSteps);
 
 	void drawGUI(Graphics &g);
-	void animateGUI(Ellipse *ellipseArray, Graphics& g);
+	void renderBackground(float scale);
+
+   #if CHORUSFLANGER_ENABLE_PROFILING
+	void paintProfiler(Graphics& g);
+	Rectangle<int> getProfilerBounds() const { return { 10, 10, 220, 146 }; }
+   #endif
 
 private:
     // Reference to processor object that created the editor
@@ -48,17 +45,38 @@ private:
 	// Labels for sliders
 	Label mFeedbackLabel, mDryWetLabel, mDepthLabel, mRateLabel, mPhaseOffsetLabel;
 
-	// Plugin combo box
-	ComboBox mType;
+	// Plugin combo boxes
+	ComboBox mType, mVoices, mInterpolation, mOversampling, mSync;
+
+	// Rings for GUI animation
+	ParticleSystem mParticles;
+
+	// Number of animation steps taken, which times ring emission, and feedback rings due but not yet emitted
+	int mAnimationStep;
+	float mFeedbackParticlesDue;
+
+	// Scatters feedback rings around the centre
+	Random mRandom;
+
+   #if CHORUSFLANGER_ENABLE_PROFILING
+	// Frames since the CPU load display was last refreshed
+	int mProfilerFrameCount = 0;
+   #endif
+
+	// Animation steps per second, set by the Rate knob
+	float mAnimationRate;
 
-	// Ellipses for GUI animation
-	Ellipse  mEllipse1, mEllipse2, mEllipse3, mEllipse4, mEllipseF1, mEllipseF2, mEllipseLeft, mEllipseRight;
+	// Animation steps due but not yet taken, and the time of the last frame in milliseconds
+	double mAnimationSteps;
+	double mLastFrameTime;
 
-	// Array of ellipses to be painted to GUI
-	Ellipse* ellipses = nullptr;
+	// Background and title, rendered once at the display's pixel scale and only again when Type or the scale changes
+	Image mBackground;
+	int mBackgroundType;
+	float mBackgroundScale;
 
-	// Rate for timer callback function
-	int mTimerRate;
+	// Newest measurements from the audio thread, read on each timer callback
+	TelemetrySnapshot mTelemetry;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChorusFlangerAudioProcessorEditor)
 };
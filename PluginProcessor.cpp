@@ -1,6 +1,25 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+// Tempo sync divisions, in the order of the Sync parameter, and the number of quarter notes in one LFO cycle
+static const char* const syncDivisionNames[] = { "Off", "4/1", "2/1", "1/1", "1/2", "1/4", "1/8", "1/16",
+												 "1/4T", "1/8T", "1/16T", "1/4D", "1/8D" };
+static const double syncBeatsPerCycle[] = { 0.0, 16.0, 8.0, 4.0, 2.0, 1.0, 0.5, 0.25,
+											2.0 / 3.0, 1.0 / 3.0, 1.0 / 6.0, 1.5, 0.75 };
+
+// State for each sample type the stages run at
+template <>
+ChorusFlangerAudioProcessor::SampleState<float>& ChorusFlangerAudioProcessor::getSampleState<float>() noexcept
+{
+	return mFloatState;
+}
+
+template <>
+ChorusFlangerAudioProcessor::SampleState<double>& ChorusFlangerAudioProcessor::getSampleState<double>() noexcept
+{
+	return mDoubleState;
+}
+
 // Constructor
 ChorusFlangerAudioProcessor::ChorusFlangerAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -21,33 +40,68 @@ ChorusFlangerAudioProcessor::ChorusFlangerAudioProcessor()
 	addParameter(mPhaseOffsetParameter = new AudioParameterFloat("phaseOffset", "Phase Offset", 0.0f, 1.0f, 0.0f));
 	addParameter(mFeedbackParameter = new AudioParameterFloat("feedback", "Feedback", 0.0f, 0.98f, 0.0f));
 	addParameter(mTypeParameter = new AudioParameterFloat("type", "Type", 0, 1, 0));
+	addParameter(mVoicesParameter = new AudioParameterInt("voices", "Voices", 1, MAX_VOICES, 1));
+	addParameter(mInterpolationParameter = new AudioParameterChoice("interpolation", "Interpolation",
+		{ "Linear", "Cubic Hermite", "Lagrange 4", "Lagrange 6", "Windowed Sinc" }, linearInterpolation));
+	addParameter(mOversamplingParameter = new AudioParameterChoice("oversampling", "Oversampling", { "Off", "2x", "4x" }, 0));
+	addParameter(mSyncParameter = new AudioParameterChoice("sync", "Sync", StringArray(syncDivisionNames, numElementsInArray(syncDivisionNames)), 0));
+
+	mRampedParameters[dryWetRamp] = mDryWetParameter;
+	mRampedParameters[depthRamp] = mDepthParameter;
+	mRampedParameters[rateRamp] = mRateParameter;
+	mRampedParameters[phaseOffsetRamp] = mPhaseOffsetParameter;
+	mRampedParameters[feedbackRamp] = mFeedbackParameter;
+
+	// Programs skip Oversampling by its position
+	jassert(getParameters()[PresetBank::oversamplingParameterIndex] == mOversamplingParameter);
 
 	// Initialize variables
-	mCircularBufferLeft = nullptr;
-	mCircularBufferRight = nullptr;
+	mNumChannels = 0;
 	mCircularBufferWriteHead = 0;
 	mCircularBufferLength = 0;
-	mDelayReadHead = 0;
-	mFeedbackLeft = 0;
-	mFeedbackRight = 0;
+	mCircularBufferMask = 0;
 	mLFOPhase = 0;
+	mIsTempoSynced = false;
+	mTempoSyncBPM = 120;
+	mTempoSyncFrequency = 0;
+	mTempoSyncPhase = 0;
+	mInputIsSilent = false;
+	mWetPeak = 0;
+	mWetSumOfSquares = 0;
+	mFeedbackSumOfSquares = 0;
+	mNumSilentSamples = 0;
+	mIsIdle = false;
+	mScratchBufferLength = 0;
+	mInterleavedDelayLines = false;
+	mPreferInterleavedDelayLines = false;
+	mMaxOfflineThreads = 0;
+	mNumVoices = 1;
+	mIsChorus = true;
+	mInterpolation = linearInterpolation;
+	mOversamplingFactor = 1;
+	mProcessingSampleRate = 0;
+	mCurrentProgram = 0;
+	mProgramChanged = false;
+	mProgramFadeState = programNotFading;
+
+	for (int voice = 0; voice < MAX_VOICES; voice++)
+	{
+		mVoicePhaseSpread[voice] = 0;
+		mVoiceGain[voice] = 0;
+	}
+
+	// Listen for parameter changes from the host and editor
+	mParametersChanged = true;
+
+	for (auto* parameter : getParameters())
+		parameter->addListener(this);
 }
 
 // Destructor
 ChorusFlangerAudioProcessor::~ChorusFlangerAudioProcessor()
 {
-	// Delete left and right delay buffers
-	if (mCircularBufferLeft != nullptr)
-	{
-		delete[] mCircularBufferLeft;
-		mCircularBufferLeft == nullptr;
-	}
-
-	if (mCircularBufferLeft != nullptr)
-	{
-		delete[] mCircularBufferRight;
-		mCircularBufferRight == nullptr;
-	}
+	for (auto* parameter : getParameters())
+		parameter->removeListener(this);
 }
 
 // Plugin instantiation function
@@ -55,115 +109,205 @@ void ChorusFlangerAudioProcessor::prepareToPlay (double sampleRate, int samplesP
 {
 	// Initialize phase
 	mLFOPhase = 0;
+	mTempoSyncPhase = 0;
 
-	// Calculate circular buffer length
-	mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+	// Prepare delay and feedback state for every channel of the current layout
+	mNumChannels = jmax(1, getTotalNumOutputChannels());
 
-	// Delete left delay buffers
-	if (mCircularBufferLeft != nullptr)
-	{
-		delete[] mCircularBufferLeft;
-		mCircularBufferLeft == nullptr;
-	}
+	// When rendering offline, split the channels between up to one thread per CPU core
+	const int maxOfflineThreads = mMaxOfflineThreads > 0 ? mMaxOfflineThreads : SystemStats::getNumCpus();
+	const int numOfflineThreads = isNonRealtime() ? jlimit(1, MAX_OFFLINE_THREADS, jmin(maxOfflineThreads, mNumChannels)) : 1;
 
-	// Initialize left buffer
-	if (mCircularBufferLeft == nullptr)
-		mCircularBufferLeft = new float[(int)mCircularBufferLength];
+	if (numOfflineThreads != mOfflineWorkers.getNumThreads())
+		mOfflineWorkers.prepare(numOfflineThreads);
 
-	// Clear any junk data
-	zeromem(mCircularBufferLeft, mCircularBufferLength * sizeof(float));
+	// A single channel gains nothing from interleaving, and channels processed on different threads
+	// would share the cache lines of every frame
+	mInterleavedDelayLines = mPreferInterleavedDelayLines && mNumChannels > 1 && numOfflineThreads == 1;
 
-	// Delete right buffer
-	if (mCircularBufferLeft != nullptr)
-	{
-		delete[] mCircularBufferRight;
-		mCircularBufferRight == nullptr;
-	}
+	// Delay buffers hold the longest delay at the highest oversampling factor, plus the widest
+	// interpolator's points, rounded up to a power of two so indices can be wrapped with a bitmask
+	const int maxCircularBufferLength = nextPowerOfTwo((int)std::ceil(sampleRate * MAX_OVERSAMPLING_FACTOR * MAX_DELAY_TIME) + MAX_INTERPOLATION_POINTS);
 
-	// Initialize right buffer
-	if (mCircularBufferRight == nullptr)
-		mCircularBufferRight = new float[(int)mCircularBufferLength];
+	// Scratch buffers hold one segment of the block processing stages at the highest oversampling factor
+	mScratchBufferLength = jmin(samplesPerBlock, PARAMETER_SEGMENT_LENGTH);
 
-	// Clear any junk data
-	zeromem(mCircularBufferRight, mCircularBufferLength * sizeof(float));
+	allocateDSPState(maxCircularBufferLength, mScratchBufferLength * MAX_OVERSAMPLING_FACTOR);
 
-	// Initialize write data
-	mCircularBufferWriteHead = 0;
+	// Build the shared wavetable and coefficient tables if this is the first instance to be prepared
+	mSharedTables->prepare();
+
+	// Prepare oversampling filters for the processing precision, then size delay state and smoothing for the current factor
+	if (isUsingDoublePrecision())
+		mDoubleState.oversampler.prepare(mNumChannels, mScratchBufferLength, mSharedTables->getFirstStageCoefficients<double>(),
+										 mSharedTables->getSecondStageCoefficients<double>());
+	else
+		mFloatState.oversampler.prepare(mNumChannels, mScratchBufferLength, mSharedTables->getFirstStageCoefficients<float>(),
+										mSharedTables->getSecondStageCoefficients<float>());
+
+	updateOversampling(1 << mOversamplingParameter->getIndex());
+
+	// Read every parameter before the first segment, with the wet signal at full level
+	mParametersChanged = true;
+	mProgramChanged = false;
+	mProgramFadeState = programNotFading;
+	mProgramFade.setCurrentAndTargetValue(1);
+
+	// Start processing straight away
+	mNumSilentSamples = 0;
+	mIsIdle = false;
+
+   #if CHORUSFLANGER_ENABLE_PROFILING
+	// Loads measured with the previous block size or sample rate no longer apply
+	mProfiler.requestReset();
+   #endif
 }
 
 // Main audio processing algorithm
 void ChorusFlangerAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
-    ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+	processSamples(buffer);
+}
 
-    // Clear any garbage data from output buffers
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-	
-	// Get left and right channel buffers
-	float* leftChannel = buffer.getWritePointer(0);
-	float* rightChannel = buffer.getWritePointer(1);
+// Main audio processing algorithm, for hosts that process in double precision
+void ChorusFlangerAudioProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+	processSamples(buffer);
+}
 
-	// Iterate through all samples in input buffer
-	for (int i = 0; i < buffer.getNumSamples(); i++)
+// Every stage is written for either sample type
+bool ChorusFlangerAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+	return true;
+}
+
+// Run the block processing stages over a buffer of either sample type
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processSamples (AudioBuffer<SampleType>& buffer)
+{
+	ScopedNoDenormals noDenormals;
+	auto totalNumInputChannels  = getTotalNumInputChannels();
+	auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+	// Clear any garbage data from output buffers
+	for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
 	{
-		// Write sample and any feedback into delay buffers
-		mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i] + mFeedbackLeft;
-		mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i] + mFeedbackRight;
+		buffer.clear (i, 0, buffer.getNumSamples());
+	}
+
+	// Time the whole block, including the idle path
+	CHORUSFLANGER_PROFILE_BLOCK(mProfiler, buffer.getNumSamples(), getSampleRate());
 
-		mCircularBufferWriteHead = updateWriteHead();
+	auto& state = getSampleState<SampleType>();
 
-		// Configure LFO for effect processing
-		auto lfo = generateLFO();
-		mLFOPhase = updateLFOPhase();
+	// Scratch buffers have not been allocated yet, or were laid out for the other precision
+	if (mScratchBufferLength == 0 || state.feedback == nullptr)
+		return;
 
-		// Apply Depth setting to LFO
-		lfo.left *= *mDepthParameter;
-		lfo.right *= *mDepthParameter;
+	// Only process channels the delay state was prepared for
+	auto numChannels = jmin(totalNumInputChannels, mNumChannels);
 
-		// Map LFO range to millisecond range according to Chorus or Flanger effect
-		auto lfoMapped = (*mTypeParameter == 0)
-			? processChorus(lfo.left, lfo.right)
-			: processFlanger(lfo.left, lfo.right);
+	// Check whether any input is above the silence threshold
+	mInputIsSilent = true;
 
-		// Determine where to read from delay buffer
-		auto delayReadHead = getDelayReadHead(lfoMapped);
-		auto interpHeads = getInterpHeads(delayReadHead);
+	for (int channel = 0; channel < numChannels && mInputIsSilent; channel++)
+		mInputIsSilent = buffer.getMagnitude(channel, 0, buffer.getNumSamples()) < SILENCE_THRESHOLD;
 
-		// Interpolate and read from delay buffer
-		auto delay_sample_left = lin_interp(mCircularBufferLeft[interpHeads.currentLeft], mCircularBufferLeft[interpHeads.nextRight], interpHeads.fractionLeft);
-		auto delay_sample_right = lin_interp(mCircularBufferRight[interpHeads.currentRight], mCircularBufferRight[interpHeads.nextRight], interpHeads.fractionRight);
+	// While idle, skip the delay and LFO work and only apply the dry gain, until input returns
+	if (mIsIdle)
+	{
+		if (mInputIsSilent)
+		{
+			applyIdleDryGain(buffer, numChannels);
+			skipLFOPhase(buffer.getNumSamples());
+
+			// Nothing is left in the delay line to fade, so a program change takes effect as soon as processing resumes
+			mProgramChanged = false;
+
+			// Nothing is left in the delay line, so the editor sees a silent wet signal
+			mWetPeak = 0;
+			mWetSumOfSquares = 0;
+			mFeedbackSumOfSquares = 0;
+			pushTelemetry(0);
+			return;
+		}
+
+		mIsIdle = false;
+	}
 
-		// Store delayed samples as feedback
-		mFeedbackLeft = delay_sample_left * *mFeedbackParameter;
-		mFeedbackRight = delay_sample_right * *mFeedbackParameter;
+	mWetPeak = 0;
+	mWetSumOfSquares = 0;
+	mFeedbackSumOfSquares = 0;
 
-		// Send Dry/Wet signal to audio buffer output
-		buffer.setSample(0, i, buffer.getSample(0, i) * (1 - *mDryWetParameter) + delay_sample_left * (*mDryWetParameter));
-		buffer.setSample(1, i, buffer.getSample(1, i) * (1 - *mDryWetParameter) + delay_sample_right * (*mDryWetParameter));
+	// Workers are only started when the host was rendering offline at prepareToPlay
+	const int numGroups = isNonRealtime() ? jmin(mOfflineWorkers.getNumThreads(), numChannels) : 1;
+
+	// Process input buffer in short segments, so parameter changes made while the block
+	// is being processed land on the next segment boundary
+	for (int start = 0; start < buffer.getNumSamples(); start += mScratchBufferLength)
+	{
+		updateProgramFade();
+
+		// Only re-read parameters when one has changed, otherwise segments run back to back.
+		// While a program change fades out, the old settings are kept until the wet signal is silent.
+		if (mProgramFadeState != programFadingOut && mParametersChanged.exchange(false))
+			updateParameterSnapshot();
+
+		// Read the host's tempo and position once for the whole block
+		if (start == 0)
+			updateTempoSync();
+
+		auto numSamples = jmin(mScratchBufferLength, buffer.getNumSamples() - start);
+		auto numProcessingSamples = numSamples * mOversamplingFactor;
+
+		// Parameter ramps and LFO phase are shared by all channels
+		processParameterRampStage(numProcessingSamples);
+		processLFOPhaseStage<SampleType>(numProcessingSamples);
+
+		// Channels only read shared state during the rest of the segment, so when rendering offline they are split
+		// into one contiguous group per thread. Meters are added up in channel order afterwards either way.
+		if (numGroups > 1)
+		{
+			auto processGroup = [&] (int group, int thread)
+			{
+				processChannelGroup(buffer, start, numSamples, group * numChannels / numGroups, (group + 1) * numChannels / numGroups, thread);
+			};
+
+			mOfflineWorkers.run(numGroups, processGroup);
+		}
+		else
+		{
+			processChannelGroup(buffer, start, numSamples, 0, numChannels, 0);
+		}
+
+		accumulateChannelMeters(numChannels);
+
+		// Advance write head past the samples written to every channel
+		mCircularBufferWriteHead = (mCircularBufferWriteHead + numProcessingSamples) & mCircularBufferMask;
 	}
+
+	updateIdleState(mInputIsSilent, buffer.getNumSamples() * mOversamplingFactor);
+	pushTelemetry(buffer.getNumSamples() * mOversamplingFactor * numChannels);
 }
 
 // Retrieves plugin state information when being loaded by the host
 void ChorusFlangerAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-	std::unique_ptr<XmlElement> xml (new XmlElement ("FlangerChorus"));
-
-	xml->setAttribute ("DryWet", *mDryWetParameter);
-	xml->setAttribute ("Depth", *mDepthParameter);
-	xml->setAttribute ("Rate", *mRateParameter);
-	xml->setAttribute ("Phase Offset", *mPhaseOffsetParameter);
-	xml->setAttribute ("Feedback", *mFeedbackParameter);
-	xml->setAttribute ("Type", *mTypeParameter);
-
-	copyXmlToBinary(*xml, destData);
+	PresetBank::writeState(destData, mCurrentProgram, getParameters());
 }
 
 // Saves plugin state information whenever the host performs a "Save" operation
 void ChorusFlangerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+	int program = mCurrentProgram;
+
+	if (PresetBank::readState(data, sizeInBytes, program, getParameters()))
+	{
+		mCurrentProgram = jlimit(0, PresetBank::getNumPrograms() - 1, program);
+		return;
+	}
+
+	// States saved before the binary format are XML
 	std::unique_ptr<XmlElement> xml(getXmlFromBinary (data, sizeInBytes));
 
 	if (xml.get() != nullptr && xml->hasTagName ("FlangerChorus"))
@@ -174,115 +318,753 @@ void ChorusFlangerAudioProcessor::setStateInformation (const void* data, int siz
 		*mPhaseOffsetParameter = xml->getDoubleAttribute("Phase Offset");
 		*mFeedbackParameter = xml->getDoubleAttribute("Feedback");
 		*mTypeParameter = xml->getIntAttribute("Type");
+		*mVoicesParameter = xml->getIntAttribute("Voices", 1);
+		*mInterpolationParameter = xml->getIntAttribute("Interpolation", linearInterpolation);
+		*mOversamplingParameter = xml->getIntAttribute("Oversampling", 0);
+		*mSyncParameter = xml->getIntAttribute("Sync", 0);
+	}
+}
+
+//========================= Block processing stages ============================
+// Fill parameter ramp buffer with per-sample smoothed parameter values
+void ChorusFlangerAudioProcessor::processParameterRampStage(int numSamples)
+{
+	CHORUSFLANGER_PROFILE_STAGE(mProfiler, parameterRampProfileStage);
+
+	for (int ramp = 0; ramp < numParameterRamps; ramp++)
+	{
+		float* values = mParameterRampBuffer.getWritePointer(ramp);
+		auto& smoother = mParameterSmoothers[ramp];
+
+		if (smoother.isSmoothing())
+		{
+			for (int i = 0; i < numSamples; i++)
+				values[i] = smoother.getNextValue();
+		}
+		else
+		{
+			FloatVectorOperations::fill(values, smoother.getTargetValue(), numSamples);
+		}
+	}
+
+	// Wet gain, only while a program change is fading
+	if (mProgramFadeState != programNotFading)
+	{
+		float* fade = mProgramFadeBuffer.getWritePointer(0);
+
+		for (int i = 0; i < numSamples; i++)
+			fade[i] = mProgramFade.getNextValue();
+	}
+}
+
+// Fill LFO phase scratch buffer for the block and advance the LFO phase
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processLFOPhaseStage(int numSamples)
+{
+	CHORUSFLANGER_PROFILE_STAGE(mProfiler, lfoProfileStage);
+
+	SampleType* lfoPhase = getSampleState<SampleType>().lfoPhaseBuffer.getWritePointer(0);
+	const float* rate = mParameterRampBuffer.getReadPointer(rateRamp);
+	const double sampleRate = mProcessingSampleRate;
+
+	// Keep state in a local so stores to the scratch buffer cannot alias it. The phase is accumulated in
+	// double precision whatever the sample type, so rounding does not build up over long renders.
+	double phase = mLFOPhase;
+
+	if (mIsTempoSynced)
+	{
+		// Synced phase advances by a constant amount from the musical position at the start of the block,
+		// accumulated in double precision so the result does not depend on the host's block size
+		const double increment = mTempoSyncFrequency / sampleRate;
+		double syncedPhase = mTempoSyncPhase;
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			lfoPhase[i] = (SampleType)syncedPhase;
+
+			syncedPhase += increment;
+
+			if (syncedPhase >= 1)
+				syncedPhase -= 1;
+		}
+
+		mTempoSyncPhase = syncedPhase;
+		phase = syncedPhase;
+	}
+	else
+	{
+		for (int i = 0; i < numSamples; i++)
+		{
+			lfoPhase[i] = (SampleType)phase;
+
+			// Increment LFO phase for next sample
+			phase += rate[i] / sampleRate;
+
+			if (phase >= 1)
+				phase -= 1;
+		}
+	}
+
+	mLFOPhase = phase;
+}
+
+// Run one segment of a range of channels on one thread: upsample each channel when oversampling,
+// run the per-channel stages and downsample back into the buffer
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processChannelGroup(AudioBuffer<SampleType>& buffer, int start, int numSamples, int startChannel, int endChannel, int thread)
+{
+	auto& state = getSampleState<SampleType>();
+	const int numProcessingSamples = numSamples * mOversamplingFactor;
+
+	// Point the stages at each channel, or at an upsampled copy of it when oversampling
+	SampleType** processingData = state.processingChannels.getRawDataPointer();
+
+	for (int channel = startChannel; channel < endChannel; channel++)
+	{
+		processingData[channel] = buffer.getWritePointer(channel, start);
+
+		if (mOversamplingFactor > 1)
+		{
+			CHORUSFLANGER_PROFILE_STAGE(mProfiler, oversamplingProfileStage);
+
+			state.oversampler.upsample(processingData[channel], state.oversampledBuffer.getWritePointer(channel), channel, numSamples);
+			processingData[channel] = state.oversampledBuffer.getWritePointer(channel);
+		}
+	}
+
+	processChannelStages(processingData, startChannel, endChannel, thread, numProcessingSamples);
+
+	if (mOversamplingFactor > 1)
+	{
+		CHORUSFLANGER_PROFILE_STAGE(mProfiler, oversamplingProfileStage);
+
+		for (int channel = startChannel; channel < endChannel; channel++)
+			state.oversampler.downsample(processingData[channel], buffer.getWritePointer(channel, start), channel, numSamples);
+	}
+}
+
+// Run the LFO, delay time, delay read, meter and mix stages for a range of channels
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processChannelStages(SampleType* const* channelData, int startChannel, int endChannel, int thread, int numSamples)
+{
+	for (int channel = startChannel; channel < endChannel; channel++)
+	{
+		processLFOStage<SampleType>(channel, thread, numSamples);
+		processDelayTimeStage<SampleType>(channel, thread, numSamples);
+	}
+
+	processDelayReadStageWithInterpolation(channelData, startChannel, endChannel, numSamples);
+
+	for (int channel = startChannel; channel < endChannel; channel++)
+	{
+		processMeterStage<SampleType>(channel, numSamples);
+		processMixStage(channelData[channel], channel, numSamples);
+	}
+}
+
+// Run the delay read stage with the selected interpolation mode
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processDelayReadStageWithInterpolation(const SampleType* const* channelData, int startChannel, int endChannel, int numSamples)
+{
+	// Interpolation and feedback run in the same loop, so they are timed together
+	CHORUSFLANGER_PROFILE_STAGE(mProfiler, delayReadProfileStage);
+
+	switch (mInterpolation)
+	{
+		case hermiteInterpolation:
+			processDelayReadStages<SampleType, hermiteInterpolation>(channelData, startChannel, endChannel, numSamples);
+			break;
+		case lagrange4Interpolation:
+			processDelayReadStages<SampleType, lagrange4Interpolation>(channelData, startChannel, endChannel, numSamples);
+			break;
+		case lagrange6Interpolation:
+			processDelayReadStages<SampleType, lagrange6Interpolation>(channelData, startChannel, endChannel, numSamples);
+			break;
+		case sincInterpolation:
+			processDelayReadStages<SampleType, sincInterpolation>(channelData, startChannel, endChannel, numSamples);
+			break;
+		default:
+			processDelayReadStages<SampleType, linearInterpolation>(channelData, startChannel, endChannel, numSamples);
+			break;
+	}
+}
+
+// Run the delay read stage for one channel after another
+template <typename SampleType, int interpolation>
+void ChorusFlangerAudioProcessor::processDelayReadStages(const SampleType* const* channelData, int startChannel, int endChannel, int numSamples)
+{
+	for (int channel = startChannel; channel < endChannel; channel++)
+		processDelayReadStage<SampleType, interpolation>(channelData[channel], channel, numSamples);
+}
+
+// Fill a thread's LFO scratch buffer with depth-scaled LFO values for every voice of a channel.
+// Voice phase spreads are fixed, so each voice is a rotation of the base LFO:
+// sin(a + b) = sin(a) cos(b) + cos(a) sin(b), which needs no extra table lookups per voice.
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processLFOStage(int channel, int thread, int numSamples)
+{
+	CHORUSFLANGER_PROFILE_STAGE(mProfiler, lfoProfileStage);
+
+	auto& state = getSampleState<SampleType>();
+	const SampleType* lfoPhase = state.lfoPhaseBuffer.getReadPointer(0);
+	SampleType* lfo = state.lfoBuffer.getWritePointer(thread);
+	const LFOWavetable& wavetable = mSharedTables->getLFOWavetable();
+
+	const float* depth = mParameterRampBuffer.getReadPointer(depthRamp);
+	const float* phaseOffset = mParameterRampBuffer.getReadPointer(phaseOffsetRamp);
+	const SampleType channelPhaseSpread = getChannelPhaseSpread(channel);
+
+	const int numVoices = mNumVoices;
+	SampleType voiceSpreadSin[MAX_VOICES], voiceSpreadCos[MAX_VOICES];
+
+	for (int voice = 0; voice < numVoices; voice++)
+	{
+		voiceSpreadSin[voice] = (SampleType)std::sin(2 * double_Pi * mVoicePhaseSpread[voice]);
+		voiceSpreadCos[voice] = (SampleType)std::cos(2 * double_Pi * mVoicePhaseSpread[voice]);
+	}
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		// Since our plugin supports phase offset, each channel has its own out-of-phase LFO
+		SampleType phase = lfoPhase[i] + phaseOffset[i] * channelPhaseSpread;
+
+		if (phase >= 1)
+			phase -= 1;
+
+		// Double precision phases are looked up with the exact sine
+		SampleType sinPhase = wavetable.lookup(phase);
+
+		if (numVoices == 1)
+		{
+			lfo[i] = depth[i] * sinPhase;
+		}
+		else
+		{
+			// Quarter cycle ahead gives the cosine
+			SampleType cosPhase = wavetable.lookup(phase < 0.75f ? phase + 0.25f : phase - 0.75f);
+
+			for (int voice = 0; voice < numVoices; voice++)
+				lfo[i * numVoices + voice] = depth[i] * (sinPhase * voiceSpreadCos[voice] + cosPhase * voiceSpreadSin[voice]);
+		}
+	}
+}
+
+// Map a thread's LFO scratch buffer to a channel's delay times in samples according to Chorus or Flanger effect
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processDelayTimeStage(int channel, int thread, int numSamples)
+{
+	CHORUSFLANGER_PROFILE_STAGE(mProfiler, delayTimeProfileStage);
+
+	auto& state = getSampleState<SampleType>();
+	const SampleType* lfo = state.lfoBuffer.getReadPointer(thread);
+	SampleType* delayTime = state.delayTimeBuffer.getWritePointer(channel);
+
+	// Chorus delays range from 5 to 30 ms, flanger delays from 1 to 5 ms
+	const SampleType minDelayTime = mIsChorus ? (SampleType)0.005 : (SampleType)0.001;
+	const SampleType maxDelayTime = mIsChorus ? (SampleType)0.03 : (SampleType)0.005;
+	const double sampleRate = mProcessingSampleRate;
+
+	for (int i = 0; i < numSamples * mNumVoices; i++)
+		delayTime[i] = sampleRate * jmap(lfo[i], (SampleType)-1, (SampleType)1, minDelayTime, maxDelayTime);
+}
+
+// Write input and feedback into a channel's delay buffer, or its part of the interleaved frames, and read the mixed
+// voices into its wet scratch buffer. Each channel's segment is short enough that the frames it writes are still in
+// cache when the next channel writes the same frames.
+// Every voice reads its own interpolation points, so the stage costs about as much again for each voice.
+template <typename SampleType, int interpolation>
+void ChorusFlangerAudioProcessor::processDelayReadStage(const SampleType* channelData, int channel, int numSamples)
+{
+	auto& state = getSampleState<SampleType>();
+	const SampleType* delayTime = state.delayTimeBuffer.getReadPointer(channel);
+	SampleType* wet = state.wetBuffer.getWritePointer(channel);
+
+	// Interleaved delay buffers hold the channel's samples every mNumChannels samples
+	SampleType* circularBuffer = mInterleavedDelayLines ? state.circularBuffer.getWritePointer(0) + channel : state.circularBuffer.getWritePointer(channel);
+	const int stride = mInterleavedDelayLines ? mNumChannels : 1;
+
+	const float* feedbackGain = mParameterRampBuffer.getReadPointer(feedbackRamp);
+	const float* sincCoefficients = mSharedTables->getSincTable().getCoefficients();
+	const int mask = mCircularBufferMask;
+
+	// Keep state in locals so stores to the delay and scratch buffers cannot alias it
+	int writeHead = mCircularBufferWriteHead;
+	SampleType feedback = state.feedback[channel];
+	const int numVoices = mNumVoices;
+	SampleType voiceGain[MAX_VOICES];
+
+	for (int voice = 0; voice < numVoices; voice++)
+		voiceGain[voice] = mVoiceGain[voice];
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		// Write sample and any feedback into delay buffer
+		circularBuffer[writeHead * stride] = channelData[i] + feedback;
+
+		writeHead = (writeHead + 1) & mask;
+
+		const SampleType* voiceDelayTime = delayTime + i * numVoices;
+		SampleType wetSample = 0;
+
+		for (int voice = 0; voice < numVoices; voice++)
+		{
+			// Calculate read head position, offset by one buffer length so it is never negative
+			SampleType readHead = writeHead + mCircularBufferLength - voiceDelayTime[voice];
+
+			// Interpolate, read from delay buffer and mix voice into wet signal
+			wetSample += voiceGain[voice] * interpolateDelayBuffer<interpolation>(circularBuffer, mask, stride, readHead, sincCoefficients);
+		}
+
+		wet[i] = wetSample;
+
+		// Store delayed sample as feedback
+		feedback = wetSample * feedbackGain[i];
 	}
+
+	state.feedback[channel] = feedback;
 }
 
-//======================== Self-created functions ==============================
-// Interpolate between two sample values
-float ChorusFlangerAudioProcessor::lin_interp(float inSampleX, float inSampleY, float inFloatPhase)
+// Measure a channel's wet scratch buffer and the feedback taken from it, for telemetry and for telling
+// when the delay line has decayed. The block's measurements are only updated once every channel is done.
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processMeterStage(int channel, int numSamples)
 {
-	// Linear interpolation equation
-	return (1 - inFloatPhase) * inSampleX + inFloatPhase * inSampleY;
+	CHORUSFLANGER_PROFILE_STAGE(mProfiler, meterProfileStage);
+
+	const SampleType* wet = getSampleState<SampleType>().wetBuffer.getReadPointer(channel);
+	const float* feedbackGain = mParameterRampBuffer.getReadPointer(feedbackRamp);
+
+	SampleType peak = 0;
+	SampleType wetSumOfSquares = 0;
+	SampleType feedbackSumOfSquares = 0;
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		SampleType feedback = wet[i] * feedbackGain[i];
+
+		peak = jmax(peak, std::abs(wet[i]));
+		wetSumOfSquares += wet[i] * wet[i];
+		feedbackSumOfSquares += feedback * feedback;
+	}
+
+	mChannelMeters[channel] = { (float)peak, wetSumOfSquares, feedbackSumOfSquares };
 }
 
-// Generate an LFO for creating a chorus or flanger effect
-ChorusFlangerAudioProcessor::LFO ChorusFlangerAudioProcessor::generateLFO()
+// Send Dry/Wet signal mix to a channel's output buffer. The ramps stay in single precision while the channel
+// may be double, which FloatVectorOperations has no overloads for, so each mix is one plain loop that reads
+// every buffer once and that the compiler vectorises for either sample type.
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::processMixStage(SampleType* channelData, int channel, int numSamples)
 {
-	float lfoOutLeft = std::sin(2 * double_Pi * mLFOPhase);
+	CHORUSFLANGER_PROFILE_STAGE(mProfiler, mixProfileStage);
 
-	// Since our plugin supports phase offset, we need an out-of-phase LFO
-	float lfoPhaseRight = mLFOPhase + *mPhaseOffsetParameter;
+	const SampleType* wet = getSampleState<SampleType>().wetBuffer.getReadPointer(channel);
+	const float* dryWet = mParameterRampBuffer.getReadPointer(dryWetRamp);
 
-	if (lfoPhaseRight >= 1)
-		lfoPhaseRight -= 1;
+	if (mProgramFadeState != programNotFading)
+	{
+		const float* fade = mProgramFadeBuffer.getReadPointer(0);
 
-	float lfoOutRight = std::sin(2 * double_Pi * lfoPhaseRight);
+		for (int i = 0; i < numSamples; i++)
+			channelData[i] = channelData[i] * (1 - dryWet[i]) + wet[i] * fade[i] * dryWet[i];
 
-	return { lfoOutLeft, lfoOutRight };
+		return;
+	}
+
+	for (int i = 0; i < numSamples; i++)
+		channelData[i] = channelData[i] * (1 - dryWet[i]) + wet[i] * dryWet[i];
 }
 
-// Perform processing for chorus effect
-ChorusFlangerAudioProcessor::LFO ChorusFlangerAudioProcessor::processChorus(float lfoLeft, float lfoRight)
+// The benchmark times each float stage on its own, so they are compiled even where processBlock inlines them
+template void ChorusFlangerAudioProcessor::processLFOStage<float>(int, int, int);
+template void ChorusFlangerAudioProcessor::processDelayTimeStage<float>(int, int, int);
+template void ChorusFlangerAudioProcessor::processDelayReadStage<float, linearInterpolation>(const float*, int, int);
+template void ChorusFlangerAudioProcessor::processDelayReadStage<float, hermiteInterpolation>(const float*, int, int);
+template void ChorusFlangerAudioProcessor::processDelayReadStage<float, lagrange4Interpolation>(const float*, int, int);
+template void ChorusFlangerAudioProcessor::processDelayReadStage<float, lagrange6Interpolation>(const float*, int, int);
+template void ChorusFlangerAudioProcessor::processDelayReadStage<float, sincInterpolation>(const float*, int, int);
+template void ChorusFlangerAudioProcessor::processMeterStage<float>(int, int);
+template void ChorusFlangerAudioProcessor::processMixStage<float>(float*, int, int);
+
+// Read every parameter once for the segment and set smoothing targets. Nothing is changed if a program
+// change started while the parameters were being read, since some of them may already hold its values.
+bool ChorusFlangerAudioProcessor::updateParameterSnapshot()
 {
-	// Map LFO values to range in milliseconds for chorus
-	float lfoOutMappedLeft = jmap(lfoLeft, -1.f, 1.f, 0.005f, 0.03f);
-	float lfoOutMappedRight = jmap(lfoRight, -1.f, 1.f, 0.005f, 0.03f);
+	float targets[numParameterRamps];
+
+	for (int ramp = 0; ramp < numParameterRamps; ramp++)
+		targets[ramp] = *mRampedParameters[ramp];
+
+	const bool isChorus = (*mTypeParameter == 0);
+	const int interpolation = mInterpolationParameter->getIndex();
+	const int numVoices = *mVoicesParameter;
+
+	// A program change is flagged before its values are written, so if the flag is still clear none of them
+	// were read. Otherwise keep the old settings and read again once the wet signal has faded out.
+	if (mProgramChanged)
+	{
+		mParametersChanged = true;
+		return false;
+	}
+
+	for (int ramp = 0; ramp < numParameterRamps; ramp++)
+		mParameterSmoothers[ramp].setTargetValue(targets[ramp]);
+
+	mIsChorus = isChorus;
+	mInterpolation = interpolation;
 
-	return { lfoOutMappedLeft, lfoOutMappedRight };
+	updateVoices(numVoices);
+	return true;
 }
 
-// Perform processing for flanger effect
-ChorusFlangerAudioProcessor::LFO ChorusFlangerAudioProcessor::processFlanger(float lfoLeft, float lfoRight)
+// Flag parameter changes so the next segment re-reads parameters. A new oversampling factor is only
+// applied, and its latency reported, at the next prepareToPlay, so the reported latency always matches
+// the factor the audio thread is using.
+void ChorusFlangerAudioProcessor::parameterValueChanged(int parameterIndex, float newValue)
 {
-	// Map LFO values to range in milliseconds for chorus
-	float lfoOutMappedLeft = jmap(lfoLeft, -1.f, 1.f, 0.001f, 0.005f);
-	float lfoOutMappedRight = jmap(lfoRight, -1.f, 1.f, 0.001f, 0.005f);
+	mParametersChanged = true;
+}
 
-	return { lfoOutMappedLeft, lfoOutMappedRight };
+void ChorusFlangerAudioProcessor::parameterGestureChanged(int parameterIndex, bool gestureIsStarting)
+{
 }
 
-// Determine read head for delay buffer based on parameter setting
-ChorusFlangerAudioProcessor::delayReadHead ChorusFlangerAudioProcessor::getDelayReadHead(LFO lfo)
+// Advance a program change at a segment boundary. The wet signal fades out on the old settings, and once
+// it is silent the new settings are read. Ramps other than Dry Wet, which also sets the dry level, jump
+// straight to their new values, since nothing they affect can be heard. The wet signal then fades back in.
+void ChorusFlangerAudioProcessor::updateProgramFade()
 {
-	// Calculate delay lengths in samples
-	float delayTimeSamplesLeft = getSampleRate() * lfo.left;
-	float delayTimeSamplesRight = getSampleRate() * lfo.right;
+	// A change made while fading in fades out again from the current level
+	if (mProgramChanged.exchange(false))
+	{
+		mProgramFade.setTargetValue(0);
+		mProgramFadeState = programFadingOut;
+	}
+
+	if (mProgramFade.isSmoothing())
+		return;
 
-	// Calculate read head positions
-	float delayReadHeadLeft = mCircularBufferWriteHead - delayTimeSamplesLeft;
-	float delayReadHeadRight = mCircularBufferWriteHead - delayTimeSamplesRight;
+	if (mProgramFadeState == programFadingOut)
+	{
+		mParametersChanged = false;
 
-	if (delayReadHeadLeft < 0)
-		delayReadHeadLeft += mCircularBufferLength;
+		// A further program change arrived while reading, so fade out again for it
+		if (! updateParameterSnapshot())
+			return;
 
-	if (delayReadHeadRight < 0)
-		delayReadHeadRight += mCircularBufferLength;
+		for (int ramp = 0; ramp < numParameterRamps; ramp++)
+			if (ramp != dryWetRamp)
+				mParameterSmoothers[ramp].setCurrentAndTargetValue(mParameterSmoothers[ramp].getTargetValue());
 
-	return { delayReadHeadLeft, delayReadHeadRight };
+		mProgramFade.setTargetValue(1);
+		mProgramFadeState = programFadingIn;
+	}
+	else if (mProgramFadeState == programFadingIn)
+	{
+		mProgramFadeState = programNotFading;
+	}
 }
 
-// Get samples from delay buffer in order to perform linear interpolation
-ChorusFlangerAudioProcessor::interpHeads ChorusFlangerAudioProcessor::getInterpHeads(delayReadHead drh)
+// Read the host's tempo and musical position once per block and lock the LFO phase to it.
+// While the transport is playing, the phase at the start of the block is derived from the
+// PPQ position alone, so loops, bounces and offline renders all give the same modulation.
+void ChorusFlangerAudioProcessor::updateTempoSync()
 {
-	// Calculate linear interpolation point for left channel
-	auto currentLeft = (int)drh.left;
-	auto nextLeft = currentLeft + 1;
-	auto fractionLeft = drh.left - currentLeft;
+	const int division = mSyncParameter->getIndex();
+
+	// Continue from the free-running phase when sync is switched on
+	if (division > 0 && ! mIsTempoSynced)
+		mTempoSyncPhase = mLFOPhase;
 
-	if (nextLeft >= mCircularBufferLength)
-		nextLeft -= mCircularBufferLength;
+	mIsTempoSynced = (division > 0);
 
-	// Calculate linear interpolation point for right channel
-	auto currentRight = (int)drh.right;
-	auto nextRight = currentRight + 1;
-	auto fractionRight = drh.right - currentRight;
+	if (! mIsTempoSynced)
+		return;
 
-	if (nextRight >= mCircularBufferLength)
-		nextRight -= mCircularBufferLength;
+	const double beatsPerCycle = syncBeatsPerCycle[division];
+	AudioPlayHead::CurrentPositionInfo position;
 
-	return { currentLeft, currentRight, nextLeft, nextRight, fractionLeft, fractionRight};
+	if (auto* playHead = getPlayHead())
+	{
+		if (playHead->getCurrentPosition(position))
+		{
+			if (position.bpm > 0)
+				mTempoSyncBPM = position.bpm;
+
+			if (position.isPlaying)
+			{
+				const double cycles = position.ppqPosition / beatsPerCycle;
+				mTempoSyncPhase = cycles - std::floor(cycles);
+			}
+		}
+	}
+
+	// Without a playing transport the LFO keeps running at the last known tempo
+	mTempoSyncFrequency = mTempoSyncBPM / (60.0 * beatsPerCycle);
 }
 
-// Increment LFO phase for next block of samples
-float ChorusFlangerAudioProcessor::updateLFOPhase()
+// Spread voices evenly over the LFO cycle, each mixed in at an equal share of the wet signal
+void ChorusFlangerAudioProcessor::updateVoices(int numVoices)
 {
-	mLFOPhase += *mRateParameter / getSampleRate();
+	mNumVoices = numVoices;
 
-	if (mLFOPhase >= 1)
-		mLFOPhase -= 1;
+	for (int voice = 0; voice < mNumVoices; voice++)
+	{
+		mVoicePhaseSpread[voice] = (float)voice / mNumVoices;
+		mVoiceGain[voice] = 1.0f / mNumVoices;
+	}
+}
+
+// Switch the delay, feedback and smoothing state to a new oversampling factor.
+// Delayed samples and filter history belong to the old rate, so they are cleared.
+void ChorusFlangerAudioProcessor::updateOversampling(int factor)
+{
+	mOversamplingFactor = factor;
+	mProcessingSampleRate = getSampleRate() * factor;
+
+	// Use as much of the delay buffers as the longest delay needs at this rate
+	mCircularBufferLength = nextPowerOfTwo((int)std::ceil(mProcessingSampleRate * MAX_DELAY_TIME) + MAX_INTERPOLATION_POINTS);
+	mCircularBufferMask = mCircularBufferLength - 1;
+	mCircularBufferWriteHead = 0;
+
+	// Smooth parameters over the same time at the new rate, starting from the parameters' current values
+	for (int ramp = 0; ramp < numParameterRamps; ramp++)
+	{
+		mParameterSmoothers[ramp].reset(mProcessingSampleRate, PARAMETER_SMOOTHING_TIME);
+		mParameterSmoothers[ramp].setCurrentAndTargetValue(*mRampedParameters[ramp]);
+	}
 
-	return mLFOPhase;
+	// Program fades last the same time at the new rate. Resetting jumps the fade to its target level.
+	mProgramFade.reset(mProcessingSampleRate, PROGRAM_FADE_TIME);
+
+	// Both precisions report the same latency
+	mFloatState.oversampler.setFactor(factor);
+	mDoubleState.oversampler.setFactor(factor);
+	setLatencySamples(mFloatState.oversampler.getLatencySamples());
+
+	clearDelayState();
+}
+
+// Lay out delay buffers, feedback and scratch buffers in the arena at the precision the host has chosen.
+// State for the other precision is dropped, so processing at it is skipped until the next prepareToPlay.
+void ChorusFlangerAudioProcessor::allocateDSPState(int circularBufferLength, int processingLength)
+{
+	if (isUsingDoublePrecision())
+	{
+		mFloatState.feedback = nullptr;
+		allocateDSPState<double>(circularBufferLength, processingLength);
+	}
+	else
+	{
+		mDoubleState.feedback = nullptr;
+		allocateDSPState<float>(circularBufferLength, processingLength);
+	}
 }
 
-// Increment write head for next block of samples
-float ChorusFlangerAudioProcessor::updateWriteHead()
+// Lay out delay buffers, feedback and scratch buffers of one sample type in the arena, which is only reallocated
+// when they need more room than it already has
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::allocateDSPState(int circularBufferLength, int processingLength)
 {
-	mCircularBufferWriteHead++;
+	auto& state = getSampleState<SampleType>();
+
+	struct BufferLayout
+	{
+		AudioBuffer<SampleType>* buffer;
+		int numChannels, numSamples;
+	};
+
+	// Interleaved delay buffers are one channel of frames holding a sample of every channel
+	const BufferLayout layout[] = {
+		{ &state.circularBuffer, mInterleavedDelayLines ? 1 : mNumChannels, mInterleavedDelayLines ? circularBufferLength * mNumChannels : circularBufferLength },
+		{ &state.lfoPhaseBuffer, 1, processingLength },
+		{ &state.lfoBuffer, mOfflineWorkers.getNumThreads(), processingLength * MAX_VOICES },
+		{ &state.delayTimeBuffer, mNumChannels, processingLength * MAX_VOICES },
+		{ &state.wetBuffer, mNumChannels, processingLength },
+		{ &state.oversampledBuffer, mNumChannels, processingLength }
+	};
+
+	// Each channel starts on an aligned boundary. Parameter ramps and the program fade stay in single precision.
+	size_t numBytes = AlignedArena::getAlignedSize<SampleType>((size_t)mNumChannels)
+					+ AlignedArena::getAlignedSize<ChannelMeter>((size_t)mNumChannels)
+					+ (numParameterRamps + 1) * AlignedArena::getAlignedSize<float>((size_t)processingLength);
+
+	for (auto& entry : layout)
+		numBytes += (size_t)entry.numChannels * AlignedArena::getAlignedSize<SampleType>((size_t)entry.numSamples);
+
+	mArena.prepare(numBytes);
+
+	state.feedback = mArena.allocate<SampleType>((size_t)mNumChannels);
+
+	mChannelMeters = mArena.allocate<ChannelMeter>((size_t)mNumChannels);
+
+	// Pointer arrays keep their storage, so they only allocate when there are more channels than before
+	state.arenaChannels.ensureStorageAllocated(jmax(mNumChannels, mOfflineWorkers.getNumThreads()));
+	state.processingChannels.ensureStorageAllocated(mNumChannels);
+
+	for (auto& entry : layout)
+	{
+		state.arenaChannels.clearQuick();
+
+		for (int channel = 0; channel < entry.numChannels; channel++)
+			state.arenaChannels.add(mArena.allocate<SampleType>((size_t)entry.numSamples));
+
+		entry.buffer->setDataToReferTo(state.arenaChannels.getRawDataPointer(), entry.numChannels, entry.numSamples);
+	}
+
+	float* parameterRampChannels[numParameterRamps];
+
+	for (int ramp = 0; ramp < numParameterRamps; ramp++)
+		parameterRampChannels[ramp] = mArena.allocate<float>((size_t)processingLength);
+
+	mParameterRampBuffer.setDataToReferTo(parameterRampChannels, numParameterRamps, processingLength);
 
-	if (mCircularBufferWriteHead >= mCircularBufferLength)
-		mCircularBufferWriteHead = 0;
+	float* programFadeChannel = mArena.allocate<float>((size_t)processingLength);
+	mProgramFadeBuffer.setDataToReferTo(&programFadeChannel, 1, processingLength);
 
-	return mCircularBufferWriteHead;
+	// Make room for a pointer to each channel's data as the stages process it
+	state.processingChannels.clearQuick();
+
+	for (int channel = 0; channel < mNumChannels; channel++)
+		state.processingChannels.add(nullptr);
+}
+
+// Clear delayed samples, feedback and filter history of whichever precision is prepared
+void ChorusFlangerAudioProcessor::clearDelayState()
+{
+	if (mFloatState.feedback != nullptr)
+		clearDelayState<float>();
+
+	if (mDoubleState.feedback != nullptr)
+		clearDelayState<double>();
+}
+
+// Clear delayed samples, feedback and filter history of one sample type
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::clearDelayState()
+{
+	auto& state = getSampleState<SampleType>();
+
+	// Only the part of each delay buffer used at the current oversampling factor holds samples
+	if (mInterleavedDelayLines)
+	{
+		state.circularBuffer.clear(0, 0, mCircularBufferLength * mNumChannels);
+	}
+	else
+	{
+		for (int channel = 0; channel < mNumChannels; channel++)
+			state.circularBuffer.clear(channel, 0, mCircularBufferLength);
+	}
+
+	for (int channel = 0; channel < mNumChannels; channel++)
+		state.feedback[channel] = 0;
+
+	state.oversampler.reset();
+}
+
+// Apply the dry gain while idle. Dry Wet keeps ramping through its smoother, so automation moves as smoothly
+// as it does while processing, and there is no jump when processing stops or resumes.
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::applyIdleDryGain(AudioBuffer<SampleType>& buffer, int numChannels)
+{
+	auto& dryWet = mParameterSmoothers[dryWetRamp];
+	dryWet.setTargetValue(*mDryWetParameter);
+
+	if (! dryWet.isSmoothing())
+	{
+		for (int channel = 0; channel < numChannels; channel++)
+			buffer.applyGain(channel, 0, buffer.getNumSamples(), 1 - dryWet.getTargetValue());
+
+		return;
+	}
+
+	SampleType* const* channelData = buffer.getArrayOfWritePointers();
+
+	for (int i = 0; i < buffer.getNumSamples(); i++)
+	{
+		// Processing only goes idle without oversampling, so the smoother steps once per sample
+		const SampleType dryGain = 1 - dryWet.getNextValue();
+
+		for (int channel = 0; channel < numChannels; channel++)
+			channelData[channel][i] *= dryGain;
+	}
+}
+
+// Advance the LFO phase without processing, so modulation resumes where it would have been
+void ChorusFlangerAudioProcessor::skipLFOPhase(int numSamples)
+{
+	if (mIsTempoSynced)
+	{
+		const double phase = mTempoSyncPhase + mTempoSyncFrequency * numSamples / getSampleRate();
+		mTempoSyncPhase = phase - std::floor(phase);
+		mLFOPhase = mTempoSyncPhase;
+	}
+	else
+	{
+		const double phase = mLFOPhase + *mRateParameter * (double)numSamples / getSampleRate();
+		mLFOPhase = phase - std::floor(phase);
+	}
+}
+
+// Add each channel's segment measurements to the block's, in channel order, so the sums are the same
+// whichever thread processed each channel
+void ChorusFlangerAudioProcessor::accumulateChannelMeters(int numChannels)
+{
+	for (int channel = 0; channel < numChannels; channel++)
+	{
+		mWetPeak = jmax(mWetPeak, mChannelMeters[channel].wetPeak);
+		mWetSumOfSquares += mChannelMeters[channel].wetSumOfSquares;
+		mFeedbackSumOfSquares += mChannelMeters[channel].feedbackSumOfSquares;
+	}
+}
+
+// Send the block's LFO phase and wet and feedback levels to the editor. The queue never blocks,
+// and if the editor has stopped reading, the snapshot is dropped.
+void ChorusFlangerAudioProcessor::pushTelemetry(int numSamples)
+{
+	TelemetrySnapshot snapshot;
+
+	snapshot.lfoPhase = (float)mLFOPhase;
+	snapshot.wetPeak = mWetPeak;
+
+	if (numSamples > 0)
+	{
+		snapshot.wetRMS = (float)std::sqrt(mWetSumOfSquares / numSamples);
+		snapshot.feedbackEnergy = (float)(mFeedbackSumOfSquares / numSamples);
+	}
+
+	mTelemetry.push(snapshot);
+}
+
+// Track silence after a processed block. Once input and wet signal have both been silent for
+// a whole delay buffer, nothing above the threshold is left to feed back, so processing can stop.
+// Idle blocks skip the oversampling filters, so the dry signal would lose the latency reported to
+// the host and shift by it on every switch, so with oversampling on processing never stops.
+void ChorusFlangerAudioProcessor::updateIdleState(bool inputIsSilent, int numSamples)
+{
+	if (mOversamplingFactor > 1 || ! inputIsSilent || mWetPeak >= SILENCE_THRESHOLD)
+	{
+		mNumSilentSamples = 0;
+		return;
+	}
+
+	mNumSilentSamples += numSamples;
+
+	if (mNumSilentSamples >= mCircularBufferLength)
+	{
+		// Drop what is left below the threshold so processing resumes from a clean state
+		clearDelayState();
+		mIsIdle = true;
+	}
+}
+
+// Fraction of Phase Offset applied to a channel, spreading it from the first to the last channel
+float ChorusFlangerAudioProcessor::getChannelPhaseSpread(int channel) const
+{
+	if (mNumChannels < 2)
+		return 0;
+
+	return (float)channel / (mNumChannels - 1);
 }
 
 //==============================================================================
@@ -324,30 +1106,62 @@ bool ChorusFlangerAudioProcessor::isMidiEffect() const
 #endif
 }
 
+// Time for the feedback path to decay below the silence threshold after input stops,
+// plus any oversampling latency
 double ChorusFlangerAudioProcessor::getTailLengthSeconds() const
 {
-	return 0.0;
+	// Each pass around the feedback path is delayed by up to the longest delay of the current type
+	const double maxDelayTime = (*mTypeParameter == 0) ? 0.03 : 0.005;
+	const double feedback = *mFeedbackParameter;
+
+	double numPasses = 1;
+
+	if (feedback > 0)
+		numPasses += std::log(SILENCE_THRESHOLD) / std::log(feedback);
+
+	double latency = 0;
+
+	if (getSampleRate() > 0)
+		latency = getLatencySamples() / getSampleRate();
+
+	return maxDelayTime * numPasses + latency;
 }
 
 int ChorusFlangerAudioProcessor::getNumPrograms()
 {
-	return 1;
+	return PresetBank::getNumPrograms();
 }
 
 int ChorusFlangerAudioProcessor::getCurrentProgram()
 {
-	return 0;
+	return mCurrentProgram;
 }
 
+// Switch to a built-in program. Parameters take the program's values straight away, and the audio thread
+// fades the wet signal out on the old settings and back in on the new ones, so the switch never allocates
+// and does not click.
 void ChorusFlangerAudioProcessor::setCurrentProgram(int index)
 {
+	if (index < 0 || index >= PresetBank::getNumPrograms())
+		return;
+
+	mCurrentProgram = index;
+
+	// Flag the change first. A snapshot that may have read any of the new values sees the flag and is discarded,
+	// so the new settings are only taken up once the wet signal has faded out.
+	mProgramChanged = true;
+
+	PresetBank::applyProgram(PresetBank::getProgram(index), getParameters());
+
+	mParametersChanged = true;
 }
 
 const String ChorusFlangerAudioProcessor::getProgramName(int index)
 {
-	return {};
+	return PresetBank::getProgram(index).name;
 }
 
+// Built-in programs cannot be renamed
 void ChorusFlangerAudioProcessor::changeProgramName(int index, const String& newName)
 {
 }
@@ -364,6 +1178,8 @@ AudioProcessorEditor* ChorusFlangerAudioProcessor::createEditor()
 
 void ChorusFlangerAudioProcessor::releaseResources()
 {
+	// Stop offline workers until the next prepareToPlay
+	mOfflineWorkers.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -373,10 +1189,9 @@ bool ChorusFlangerAudioProcessor::isBusesLayoutSupported(const BusesLayout& layo
 	ignoreUnused(layouts);
 	return true;
 #else
-	// This is the place where you check if the layout is supported.
-	// In this template code we only support mono or stereo.
-	if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-		&& layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+	// Any layout is supported (mono, stereo, surround or ambisonic),
+	// since delay and LFO state is kept per channel
+	if (layouts.getMainOutputChannelSet().isDisabled())
 		return false;
 
 	// This checks if the input layout matches the output layout
@@ -1,10 +1,37 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
-#define MAX_DELAY_TIME 2
+#include "LFOWavetable.h"
+#include "Interpolation.h"
+#include "Oversampling.h"
+#include "SharedTables.h"
+#include "Telemetry.h"
+#include "Profiler.h"
+#include "AlignedArena.h"
+#include "PresetBank.h"
+#include "OfflineWorkerPool.h"
+
+// Longest delay either effect can produce, in seconds (chorus maximum)
+#define MAX_DELAY_TIME 0.03
+
+// Length of parameter smoothing ramps, in seconds
+#define PARAMETER_SMOOTHING_TIME 0.05
+
+// Length of the wet signal fading out and back in around a program change, in seconds
+#define PROGRAM_FADE_TIME 0.01
+
+// Largest number of ensemble voices
+#define MAX_VOICES 8
+
+// Longest segment processed between checks for parameter changes, in samples
+#define PARAMETER_SEGMENT_LENGTH 64
+
+// Level below which input and delayed signals are treated as silent (-100 dB)
+#define SILENCE_THRESHOLD 1.0e-5f
 
 //==============================================================================
-class ChorusFlangerAudioProcessor  : public AudioProcessor
+class ChorusFlangerAudioProcessor  : public AudioProcessor,
+									 private AudioProcessorParameter::Listener
 {
 public:
     //==============================================================================
@@ -20,6 +47,8 @@ public:
    #endif
 
     void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     AudioProcessorEditor* createEditor() override;
@@ -44,51 +73,271 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-	//========================= Self-created functions =============================
-	float lin_interp(float inSampleX, float inSampleY, float inFloatPhase);
-	float updateLFOPhase();
-	float updateWriteHead();
+	// Take the newest telemetry snapshot from the audio thread, returning false if none has arrived.
+	// Only the editor's message thread may call this.
+	bool popTelemetry(TelemetrySnapshot& snapshot) { return mTelemetry.popLatest(snapshot); }
+
+	// Choose whether multichannel delay buffers are stored as interleaved frames or one channel after
+	// another (the default). Output is identical either way. Takes effect at the next prepareToPlay.
+	void setInterleavedDelayLines(bool shouldInterleave) { mPreferInterleavedDelayLines = shouldInterleave; }
+
+	// Choose how many threads, including the host's, share the channels of each block while the host renders
+	// offline: 0 (the default) for one per CPU core, or 1 to stay on the host's thread. Output is identical
+	// either way. Takes effect at the next prepareToPlay, and only if the host is rendering offline by then.
+	void setMaxOfflineThreads(int maxThreads) { mMaxOfflineThreads = maxThreads; }
+
+   #if CHORUSFLANGER_ENABLE_PROFILING
+	// Stage timings and CPU load histogram, readable from any thread
+	ProcessorProfiler& getProfiler() { return mProfiler; }
+   #endif
+
+	//========================= Block processing stages ============================
+	// Stages run at the sample type of the buffer the host passes, apart from the parameter ramps
+	template <typename SampleType>
+	void processSamples(AudioBuffer<SampleType>& buffer);
+	void processParameterRampStage(int numSamples);
+	template <typename SampleType>
+	void processLFOPhaseStage(int numSamples);
+	template <typename SampleType>
+	void processChannelGroup(AudioBuffer<SampleType>& buffer, int start, int numSamples, int startChannel, int endChannel, int thread);
+	template <typename SampleType>
+	void processChannelStages(SampleType* const* channelData, int startChannel, int endChannel, int thread, int numSamples);
+	template <typename SampleType>
+	void processLFOStage(int channel, int thread, int numSamples);
+	template <typename SampleType>
+	void processDelayTimeStage(int channel, int thread, int numSamples);
+	template <typename SampleType, int interpolation>
+	void processDelayReadStage(const SampleType* channelData, int channel, int numSamples);
+	template <typename SampleType>
+	void processMeterStage(int channel, int numSamples);
+	template <typename SampleType>
+	void processMixStage(SampleType* channelData, int channel, int numSamples);
+
+private:
+	// Flag parameter changes so the next segment re-reads parameters
+	void parameterValueChanged(int parameterIndex, float newValue) override;
+	void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override;
+
+	// Read every parameter once for the segment and set smoothing targets, unless a program change
+	// started meanwhile. Returns false if the settings were left as they were.
+	bool updateParameterSnapshot();
+
+	// Spread a number of ensemble voices over the LFO cycle
+	void updateVoices(int numVoices);
+
+	// Switch the delay, feedback and smoothing state to a new oversampling factor, from prepareToPlay only
+	void updateOversampling(int factor);
+
+	// Lay out delay buffers, feedback and scratch buffers in the arena at the processing precision
+	void allocateDSPState(int circularBufferLength, int processingLength);
+	template <typename SampleType>
+	void allocateDSPState(int circularBufferLength, int processingLength);
+
+	// Clear delayed samples, feedback and filter history
+	void clearDelayState();
+	template <typename SampleType>
+	void clearDelayState();
+
+	// Track silence after a processed block, switching to idle once the delay line has decayed and oversampling is off
+	void updateIdleState(bool inputIsSilent, int numSamples);
+
+	// Apply the smoothed dry gain while idle
+	template <typename SampleType>
+	void applyIdleDryGain(AudioBuffer<SampleType>& buffer, int numChannels);
+
+	// Advance the LFO phase without processing while idle
+	void skipLFOPhase(int numSamples);
+
+	// Add each channel's segment measurements to the block's, in channel order
+	void accumulateChannelMeters(int numChannels);
+
+	// Send the block's measurements to the editor
+	void pushTelemetry(int numSamples);
+
+	// Start fading the wet signal out after a program change, read the new settings once it is silent,
+	// and stop once it has faded back in
+	void updateProgramFade();
+
+	// Read the host's tempo and musical position once per block and lock the LFO phase to it
+	void updateTempoSync();
+
+	// Fraction of Phase Offset applied to a channel, spreading it from the first to the last channel
+	float getChannelPhaseSpread(int channel) const;
+
+	// Run the delay read stage with the selected interpolation mode
+	template <typename SampleType>
+	void processDelayReadStageWithInterpolation(const SampleType* const* channelData, int startChannel, int endChannel, int numSamples);
+
+	// Run the delay read stage for a range of channels
+	template <typename SampleType, int interpolation>
+	void processDelayReadStages(const SampleType* const* channelData, int startChannel, int endChannel, int numSamples);
+
+	// Delay lines, feedback, scratch buffers and oversampling filters at one sample type. Only the
+	// state for the precision the host has chosen is laid out in the arena and prepared.
+	template <typename SampleType>
+	struct SampleState
+	{
+		// Circular buffers used for delay, one per channel, or a single buffer of interleaved frames
+		AudioBuffer<SampleType> circularBuffer;
+
+		// Feedback for each channel, or nullptr while this precision is not prepared
+		SampleType* feedback = nullptr;
+
+		// Scratch buffers written by the block processing stages. The LFO phase buffer is shared by every
+		// channel and the LFO buffer only holds the channel each thread is processing, while delay time
+		// and wet buffers hold every channel, so the delay read stage can run for all channels at once.
+		// LFO and delay time buffers hold mNumVoices interleaved voice values per sample.
+		// Every stage runs at the oversampled rate, so buffers hold up to MAX_OVERSAMPLING_FACTOR times the block
+		AudioBuffer<SampleType> lfoPhaseBuffer;
+		AudioBuffer<SampleType> lfoBuffer;
+		AudioBuffer<SampleType> delayTimeBuffer;
+		AudioBuffer<SampleType> wetBuffer;
+
+		// Upsampled samples of each channel
+		AudioBuffer<SampleType> oversampledBuffer;
+
+		// Each channel's samples as the stages process them, in the host's buffer or the upsampled copy
+		Array<SampleType*> processingChannels;
 
-	struct LFO
+		// Channel pointers passed to buffers as they are laid out in the arena
+		Array<SampleType*> arenaChannels;
+
+		// Up and downsampling around the per-channel stages when oversampling is on
+		Oversampler<SampleType> oversampler;
+	};
+
+	template <typename SampleType>
+	SampleState<SampleType>& getSampleState() noexcept;
+
+
+	// Aligned memory for the delay, feedback and scratch buffers below, which refer into it
+	AlignedArena mArena;
+
+	// State for processing float and double buffers
+	SampleState<float> mFloatState;
+	SampleState<double> mDoubleState;
+
+	// Whether delay buffers are interleaved, and whether they should be from the next prepareToPlay
+	bool mInterleavedDelayLines;
+	bool mPreferInterleavedDelayLines;
+
+	// Number of channels the delay and feedback state is prepared for
+	int mNumChannels;
+
+	// Delay buffer size, always a power of two
+	int mCircularBufferLength;
+
+	// Bitmask used to wrap delay buffer indices
+	int mCircularBufferMask;
+
+	// Write head for delay buffer
+	int mCircularBufferWriteHead;
+
+	// Phase of LFO, kept in double precision so either sample type can carry it between blocks
+	double mLFOPhase;
+
+	// Whether the LFO follows the host tempo, the last tempo reported, the LFO frequency
+	// it gives and the synced phase, kept in double precision
+	bool mIsTempoSynced;
+	double mTempoSyncBPM;
+	double mTempoSyncFrequency;
+	double mTempoSyncPhase;
+
+	// LFO wavetable, sinc and half-band coefficients shared by all plugin instances, built on the first prepareToPlay
+	SharedResourcePointer<SharedTables> mSharedTables;
+
+	// Interpolation mode read once per segment
+	int mInterpolation;
+
+	// Current oversampling factor (1, 2 or 4) and the rate the per-channel stages run at
+	int mOversamplingFactor;
+	double mProcessingSampleRate;
+
+	// Number of ensemble voices read from each delay line
+	int mNumVoices;
+
+	// Per-voice LFO phase spread and wet gain
+	float mVoicePhaseSpread[MAX_VOICES];
+	float mVoiceGain[MAX_VOICES];
+
+	// Parameters ramped per sample, in the order of their ramp buffer channels
+	enum ParameterRamp
 	{
-		float left, right;
+		dryWetRamp,
+		depthRamp,
+		rateRamp,
+		phaseOffsetRamp,
+		feedbackRamp,
+		numParameterRamps
 	};
-	LFO generateLFO();
-	LFO processChorus(float lfoLeft, float lfoRight);
-	LFO processFlanger(float lfoLeft, float lfoRight);
 
-	struct delayReadHead
+	// Ramped parameters and their smoothed values
+	AudioParameterFloat* mRampedParameters[numParameterRamps];
+	SmoothedValue<float> mParameterSmoothers[numParameterRamps];
+
+	// Per-sample values of each ramped parameter for the current block
+	AudioBuffer<float> mParameterRampBuffer;
+
+	// Built-in program last selected, and whether it was selected since the last segment
+	int mCurrentProgram;
+	std::atomic<bool> mProgramChanged;
+
+	// Where a program change is in fading the wet signal out and back in
+	enum ProgramFadeState
 	{
-		float left, right;
+		programNotFading,
+		programFadingOut,
+		programFadingIn
 	};
-	delayReadHead getDelayReadHead(LFO lfo);
 
-	struct interpHeads
+	// Current program fade state, the wet gain it ramps and the per-sample gain for the current segment
+	ProgramFadeState mProgramFadeState;
+	SmoothedValue<float> mProgramFade;
+	AudioBuffer<float> mProgramFadeBuffer;
+
+	// Whether the current block's input is silent, the loudest wet sample in it, the number of samples
+	// in a row with silent input and wet signal, and whether processing is skipped until input returns
+	bool mInputIsSilent;
+	float mWetPeak;
+	int mNumSilentSamples;
+	bool mIsIdle;
+
+	// Sums of squared wet and feedback samples over the current block, for telemetry
+	double mWetSumOfSquares;
+	double mFeedbackSumOfSquares;
+
+	// Loudest wet sample and sums of squares of each channel in the current segment, kept apart
+	// so channels processed on different threads are added up in the same order every time
+	struct ChannelMeter
 	{
-		int currentLeft, currentRight, nextLeft, nextRight;
-		float fractionLeft, fractionRight;
+		float wetPeak;
+		double wetSumOfSquares;
+		double feedbackSumOfSquares;
 	};
-	interpHeads getInterpHeads(delayReadHead drh);
 
-private:
-	// Circular buffers used for delay
-	float* mCircularBufferLeft;
-	float* mCircularBufferRight;
+	ChannelMeter* mChannelMeters = nullptr;
 
-	// Delay buffer size
-	int mCircularBufferLength;
+	// Workers that share each segment's channels while the host renders offline, and the most threads
+	// to use, with 0 for one per CPU core
+	OfflineWorkerPool mOfflineWorkers;
+	int mMaxOfflineThreads;
 
-	// Write head for delay buffer
-	int mCircularBufferWriteHead;
+	// Snapshots sent from the audio thread to the editor once per block
+	TelemetryQueue mTelemetry;
+
+   #if CHORUSFLANGER_ENABLE_PROFILING
+	// Timing of each block and its stages
+	ProcessorProfiler mProfiler;
+   #endif
 
-	// Read head for delay buffer
-	float mDelayReadHead;
+	// Set whenever a parameter changes, and cleared when the parameters are next read
+	std::atomic<bool> mParametersChanged;
 
-	// Feedback variables
-	float mFeedbackLeft, mFeedbackRight;
+	// Type setting read once per segment
+	bool mIsChorus;
 
-	// Phase of LFO
-	float mLFOPhase;
+	// Number of base rate samples in a segment, which the scratch buffers can hold at the highest oversampling factor
+	int mScratchBufferLength;
 
 	// Plugin parameters
 	AudioParameterFloat* mRateParameter;
@@ -97,6 +346,10 @@ private:
 	AudioParameterFloat* mDryWetParameter;
 	AudioParameterFloat* mFeedbackParameter;
 	AudioParameterFloat* mTypeParameter;
+	AudioParameterInt* mVoicesParameter;
+	AudioParameterChoice* mInterpolationParameter;
+	AudioParameterChoice* mOversamplingParameter;
+	AudioParameterChoice* mSyncParameter;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChorusFlangerAudioProcessor)
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+// Built-in programs and the compact binary state they are saved in.
+//
+// Every program is a fixed set of parameter values, stored in the order the processor adds its
+// parameters, so switching programs only writes values into the existing parameters and never
+// allocates. Oversampling is a setup setting rather than part of a sound, and only takes effect
+// when the host prepares the plugin, so programs leave it as the user set it. The bank is
+// read-only: programs cannot be renamed or overwritten.
+//
+// Binary state is a magic number, a format version, the current program, the number of parameter
+// values that follow and the values themselves. States with fewer values than the processor has
+// parameters leave the rest unchanged, and extra values are ignored. States written by a newer
+// format version are rejected, since their layout after the version is unknown.
+class PresetBank
+{
+public:
+	// Number of automatable parameters, in the order they are added to the processor
+	static constexpr int numParameters = 10;
+
+	// Position of the Oversampling parameter, which programs do not set
+	static constexpr int oversamplingParameterIndex = 8;
+
+	struct Program
+	{
+		const char* name;
+		float values[numParameters - 1];
+	};
+
+	static int getNumPrograms() noexcept
+	{
+		int numPrograms;
+		getPrograms(numPrograms);
+
+		return numPrograms;
+	}
+
+	static const Program& getProgram(int index) noexcept
+	{
+		int numPrograms;
+		const Program* programs = getPrograms(numPrograms);
+
+		return programs[jlimit(0, numPrograms - 1, index)];
+	}
+
+	//========================= Binary state ========================================
+	// Marks a binary state, chosen so it can never match the header of copyXmlToBinary's format
+	static constexpr int stateMagic = 0x53504643;
+
+	// Increment when the layout after the version changes
+	static constexpr int stateVersion = 1;
+
+	// Write the current program and parameter values, in the processor's parameter order
+	static void writeState(MemoryBlock& destData, int currentProgram, const Array<AudioProcessorParameter*>& parameters)
+	{
+		MemoryOutputStream stream(destData, false);
+
+		stream.writeInt(stateMagic);
+		stream.writeInt(stateVersion);
+		stream.writeInt(currentProgram);
+		stream.writeInt(parameters.size());
+
+		for (auto* parameter : parameters)
+			stream.writeFloat(getParameterValue(parameter));
+	}
+
+	// Read a state written by writeState into the parameters. Returns false, leaving everything unchanged,
+	// if the data is not a binary state this version can read, so the caller can try the old XML format instead.
+	static bool readState(const void* data, int sizeInBytes, int& currentProgram, const Array<AudioProcessorParameter*>& parameters)
+	{
+		// Magic, version, program and number of values
+		const int headerSize = 4 * (int)sizeof(int);
+
+		if (data == nullptr || sizeInBytes < headerSize)
+			return false;
+
+		MemoryInputStream stream(data, (size_t)sizeInBytes, false);
+
+		if (stream.readInt() != stateMagic)
+			return false;
+
+		const int version = stream.readInt();
+
+		if (version < 1 || version > stateVersion)
+			return false;
+
+		currentProgram = stream.readInt();
+
+		const int numValues = jmin(stream.readInt(), parameters.size(), (int)(stream.getNumBytesRemaining() / (int64)sizeof(float)));
+
+		for (int index = 0; index < numValues; index++)
+			setParameterValue(parameters[index], stream.readFloat());
+
+		return true;
+	}
+
+	// Set every parameter except Oversampling to a program's values
+	static void applyProgram(const Program& program, const Array<AudioProcessorParameter*>& parameters)
+	{
+		const float* value = program.values;
+
+		for (int index = 0; index < jmin(numParameters, parameters.size()); index++)
+			if (index != oversamplingParameterIndex)
+				setParameterValue(parameters[index], *value++);
+	}
+
+private:
+	// Values are stored in each parameter's own range, as the XML state does
+	static float getParameterValue(AudioProcessorParameter* parameter)
+	{
+		if (auto* ranged = dynamic_cast<RangedAudioParameter*>(parameter))
+			return ranged->convertFrom0to1(ranged->getValue());
+
+		return parameter->getValue();
+	}
+
+	static void setParameterValue(AudioProcessorParameter* parameter, float value)
+	{
+		if (auto* ranged = dynamic_cast<RangedAudioParameter*>(parameter))
+			value = ranged->convertTo0to1(value);
+
+		parameter->setValueNotifyingHost(jlimit(0.0f, 1.0f, value));
+	}
+
+	static const Program* getPrograms(int& numPrograms) noexcept
+	{
+		// Dry Wet, Depth, Rate, Phase Offset, Feedback, Type, Voices, Interpolation, Sync
+		static const Program programs[] = {
+			{ "Init", { 0.0f, 0.5f, 10.0f, 0.0f, 0.0f, 0, 1, 0, 0 } },
+			{ "Subtle Chorus", { 0.35f, 0.4f, 0.8f, 0.5f, 0.0f, 0, 1, 1, 0 } },
+			{ "Wide Ensemble", { 0.5f, 0.6f, 0.6f, 0.5f, 0.1f, 0, 4, 1, 0 } },
+			{ "Lush Eight Voices", { 0.5f, 0.7f, 0.4f, 0.5f, 0.2f, 0, 8, 2, 0 } },
+			{ "Vibrato", { 1.0f, 0.5f, 5.0f, 0.0f, 0.0f, 0, 1, 1, 0 } },
+			{ "Jet Flanger", { 0.5f, 0.9f, 0.25f, 0.25f, 0.85f, 1, 1, 2, 0 } },
+			{ "Quarter Note Flanger", { 0.5f, 0.8f, 1.0f, 0.5f, 0.7f, 1, 1, 1, 5 } },
+			{ "Metallic Flanger", { 0.5f, 0.3f, 0.2f, 0.0f, 0.95f, 1, 1, 4, 0 } }
+		};
+
+		numPrograms = numElementsInArray(programs);
+		return programs;
+	}
+};
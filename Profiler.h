@@ -0,0 +1,240 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Set to 1 (for example in the exporter's preprocessor definitions) to time each processing stage
+// and record a CPU load histogram. When 0 the profiler is not compiled in at all.
+#ifndef CHORUSFLANGER_ENABLE_PROFILING
+ #define CHORUSFLANGER_ENABLE_PROFILING 0
+#endif
+
+#if CHORUSFLANGER_ENABLE_PROFILING
+
+//==============================================================================
+// Processing stages timed separately, in the order they run
+enum ProfileStage
+{
+	parameterRampProfileStage,
+	lfoProfileStage,
+	delayTimeProfileStage,
+	delayReadProfileStage,
+	meterProfileStage,
+	mixProfileStage,
+	oversamplingProfileStage,
+	numProfileStages
+};
+
+//==============================================================================
+// Per-stage timing and a histogram of each block's processing time as a fraction of the time
+// the block lasts in real time.
+//
+// The audio thread accumulates stage times for the current block and publishes totals through relaxed
+// atomics once the block is finished, so any other thread can read a report without locking. Figures
+// in a report can be up to one block apart from each other. While rendering offline, stages run on
+// several threads at once add up their time, so stage loads can add up to more than the block load.
+class ProcessorProfiler
+{
+public:
+	// Blocks are counted in 5% load bins, with the last bin for blocks over the real time budget
+	static constexpr int numLoadBins = 21;
+
+	struct Report
+	{
+		int64 numBlocks = 0;
+		float averageLoad = 0;
+		float peakLoad = 0;
+		float stageLoad[numProfileStages] = {};
+		uint32 loadHistogram[numLoadBins] = {};
+	};
+
+	ProcessorProfiler()
+	{
+		clear();
+	}
+
+	// Called by the audio thread at the start of every block
+	void startBlock() noexcept
+	{
+		if (mResetRequested.exchange(false))
+			clear();
+
+		for (int stage = 0; stage < numProfileStages; stage++)
+			mBlockStageTicks[stage].store(0, std::memory_order_relaxed);
+
+		mBlockStartTicks = Time::getHighResolutionTicks();
+	}
+
+	// Called by the audio thread, or an offline worker it is waiting for, as each stage finishes
+	void addStageTicks(int stage, int64 ticks) noexcept
+	{
+		mBlockStageTicks[stage].fetch_add(ticks, std::memory_order_relaxed);
+	}
+
+	// Called by the audio thread at the end of every block
+	void finishBlock(int numSamples, double sampleRate) noexcept
+	{
+		const int64 blockTicks = Time::getHighResolutionTicks() - mBlockStartTicks;
+
+		if (numSamples == 0 || sampleRate <= 0)
+			return;
+
+		const double budgetTicks = numSamples / sampleRate * Time::getHighResolutionTicksPerSecond();
+		const float load = (float)(blockTicks / budgetTicks);
+		const int bin = jlimit(0, numLoadBins - 1, (int)(load * (numLoadBins - 1)));
+
+		mLoadHistogram[bin].store(mLoadHistogram[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		for (int stage = 0; stage < numProfileStages; stage++)
+			mTotalStageTicks[stage].store(mTotalStageTicks[stage].load(std::memory_order_relaxed) + mBlockStageTicks[stage].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+		mTotalBlockTicks.store(mTotalBlockTicks.load(std::memory_order_relaxed) + blockTicks, std::memory_order_relaxed);
+		mTotalBudgetTicks.store(mTotalBudgetTicks.load(std::memory_order_relaxed) + budgetTicks, std::memory_order_relaxed);
+		mPeakLoad.store(jmax(mPeakLoad.load(std::memory_order_relaxed), load), std::memory_order_relaxed);
+		mNumBlocks.store(mNumBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Clear every figure before the audio thread's next block. Safe to call from any thread.
+	void requestReset() noexcept
+	{
+		mResetRequested = true;
+	}
+
+	// Read the figures gathered so far. Safe to call from any thread.
+	Report getReport() const noexcept
+	{
+		Report report;
+		report.numBlocks = mNumBlocks.load(std::memory_order_relaxed);
+		report.peakLoad = mPeakLoad.load(std::memory_order_relaxed);
+
+		const double budgetTicks = mTotalBudgetTicks.load(std::memory_order_relaxed);
+
+		if (budgetTicks > 0)
+		{
+			report.averageLoad = (float)(mTotalBlockTicks.load(std::memory_order_relaxed) / budgetTicks);
+
+			for (int stage = 0; stage < numProfileStages; stage++)
+				report.stageLoad[stage] = (float)(mTotalStageTicks[stage].load(std::memory_order_relaxed) / budgetTicks);
+		}
+
+		for (int bin = 0; bin < numLoadBins; bin++)
+			report.loadHistogram[bin] = mLoadHistogram[bin].load(std::memory_order_relaxed);
+
+		return report;
+	}
+
+	// Plain text version of a report, for headless hosts and logs
+	String createReportText() const
+	{
+		auto report = getReport();
+		String text;
+
+		text << "Blocks: " << String(report.numBlocks) << "\n"
+			 << "Average load: " << String(report.averageLoad * 100, 2) << "%\n"
+			 << "Peak load: " << String(report.peakLoad * 100, 2) << "%\n\n"
+			 << "Stage load:\n";
+
+		for (int stage = 0; stage < numProfileStages; stage++)
+			text << "  " << String(getStageName(stage)).paddedRight(' ', 28) << String(report.stageLoad[stage] * 100, 3) << "%\n";
+
+		text << "\nLoad histogram:\n";
+
+		for (int bin = 0; bin < numLoadBins; bin++)
+		{
+			String range = (bin == numLoadBins - 1) ? String(">= 100%") : String(bin * 5) + "-" + String(bin * 5 + 5) + "%";
+			text << "  " << range.paddedRight(' ', 10) << String(report.loadHistogram[bin]) << "\n";
+		}
+
+		return text;
+	}
+
+	static const char* getStageName(int stage) noexcept
+	{
+		static const char* const names[] = { "Parameter ramps", "LFO", "Read heads", "Interpolation and feedback",
+											 "Meter", "Mix", "Oversampling" };
+
+		return names[stage];
+	}
+
+private:
+	void clear() noexcept
+	{
+		for (int stage = 0; stage < numProfileStages; stage++)
+			mTotalStageTicks[stage] = 0;
+
+		for (int bin = 0; bin < numLoadBins; bin++)
+			mLoadHistogram[bin] = 0;
+
+		mTotalBlockTicks = 0;
+		mTotalBudgetTicks = 0;
+		mPeakLoad = 0;
+		mNumBlocks = 0;
+	}
+
+	// Written and read only by the audio thread, apart from stage ticks added by offline workers
+	int64 mBlockStartTicks = 0;
+	std::atomic<int64> mBlockStageTicks[numProfileStages];
+
+	// Written by the audio thread, read by any thread
+	std::atomic<int64> mTotalStageTicks[numProfileStages];
+	std::atomic<int64> mTotalBlockTicks;
+	std::atomic<double> mTotalBudgetTicks;
+	std::atomic<float> mPeakLoad;
+	std::atomic<int64> mNumBlocks;
+	std::atomic<uint32> mLoadHistogram[numLoadBins];
+
+	std::atomic<bool> mResetRequested { false };
+};
+
+//==============================================================================
+// Times the enclosing scope as one stage of the current block
+class ScopedProfileStage
+{
+public:
+	ScopedProfileStage(ProcessorProfiler& profiler, int stage) noexcept
+		: mProfiler(profiler), mStage(stage), mStartTicks(Time::getHighResolutionTicks())
+	{
+	}
+
+	~ScopedProfileStage()
+	{
+		mProfiler.addStageTicks(mStage, Time::getHighResolutionTicks() - mStartTicks);
+	}
+
+private:
+	ProcessorProfiler& mProfiler;
+	int mStage;
+	int64 mStartTicks;
+};
+
+// Times the enclosing scope as a whole block of numSamples samples
+class ScopedProfileBlock
+{
+public:
+	ScopedProfileBlock(ProcessorProfiler& profiler, int numSamples, double sampleRate) noexcept
+		: mProfiler(profiler), mNumSamples(numSamples), mSampleRate(sampleRate)
+	{
+		mProfiler.startBlock();
+	}
+
+	~ScopedProfileBlock()
+	{
+		mProfiler.finishBlock(mNumSamples, mSampleRate);
+	}
+
+private:
+	ProcessorProfiler& mProfiler;
+	int mNumSamples;
+	double mSampleRate;
+};
+
+ #define CHORUSFLANGER_PROFILE_BLOCK(profiler, numSamples, sampleRate) \
+	ScopedProfileBlock JUCE_JOIN_MACRO(profileBlock, __LINE__) (profiler, numSamples, sampleRate)
+ #define CHORUSFLANGER_PROFILE_STAGE(profiler, stage) \
+	ScopedProfileStage JUCE_JOIN_MACRO(profileStage, __LINE__) (profiler, stage)
+
+#else
+
+ #define CHORUSFLANGER_PROFILE_BLOCK(profiler, numSamples, sampleRate)
+ #define CHORUSFLANGER_PROFILE_STAGE(profiler, stage)
+
+#endif
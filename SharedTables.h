@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LFOWavetable.h"
+#include "Interpolation.h"
+#include "Oversampling.h"
+
+//==============================================================================
+// Read-only DSP tables shared by every plugin instance in the process.
+//
+// Hold one through a SharedResourcePointer, which keeps a single copy alive for as long as any
+// instance refers to it. Tables are empty until the first call to prepare, so instances that are
+// created but never played cost nothing, and a session of hundreds of instances builds them once
+// and reads them from the same cache lines. After prepare returns the tables never change, so
+// any thread can read them without locking.
+class SharedTables
+{
+public:
+	SharedTables() = default;
+
+	// Build every table, only doing the work the first time any instance calls it. Safe to call from any thread.
+	void prepare()
+	{
+		if (mIsBuilt.load(std::memory_order_acquire))
+			return;
+
+		const ScopedLock lock(mBuildLock);
+
+		if (mIsBuilt.load(std::memory_order_relaxed))
+			return;
+
+		mLFOWavetable.build();
+		mSincTable.build();
+
+		// Coefficients for both processing precisions, since an instance can switch between prepareToPlay calls
+		mFloatFirstStage.build(Oversampler<float>::firstStageNumTaps, Oversampler<float>::stopbandAttenuation);
+		mFloatSecondStage.build(Oversampler<float>::secondStageNumTaps, Oversampler<float>::stopbandAttenuation);
+		mDoubleFirstStage.build(Oversampler<double>::firstStageNumTaps, Oversampler<double>::stopbandAttenuation);
+		mDoubleSecondStage.build(Oversampler<double>::secondStageNumTaps, Oversampler<double>::stopbandAttenuation);
+
+		mIsBuilt.store(true, std::memory_order_release);
+	}
+
+	const LFOWavetable& getLFOWavetable() const noexcept { return mLFOWavetable; }
+	const SincInterpolationTable& getSincTable() const noexcept { return mSincTable; }
+
+	// Half-band coefficients for each stage of an Oversampler of the given sample type
+	template <typename SampleType>
+	const HalfBandCoefficients<SampleType>& getFirstStageCoefficients() const noexcept;
+
+	template <typename SampleType>
+	const HalfBandCoefficients<SampleType>& getSecondStageCoefficients() const noexcept;
+
+private:
+	LFOWavetable mLFOWavetable;
+	SincInterpolationTable mSincTable;
+	HalfBandCoefficients<float> mFloatFirstStage, mFloatSecondStage;
+	HalfBandCoefficients<double> mDoubleFirstStage, mDoubleSecondStage;
+
+	CriticalSection mBuildLock;
+	std::atomic<bool> mIsBuilt { false };
+
+	JUCE_DECLARE_NON_COPYABLE(SharedTables)
+};
+
+template <>
+inline const HalfBandCoefficients<float>& SharedTables::getFirstStageCoefficients<float>() const noexcept { return mFloatFirstStage; }
+
+template <>
+inline const HalfBandCoefficients<double>& SharedTables::getFirstStageCoefficients<double>() const noexcept { return mDoubleFirstStage; }
+
+template <>
+inline const HalfBandCoefficients<float>& SharedTables::getSecondStageCoefficients<float>() const noexcept { return mFloatSecondStage; }
+
+template <>
+inline const HalfBandCoefficients<double>& SharedTables::getSecondStageCoefficients<double>() const noexcept { return mDoubleSecondStage; }
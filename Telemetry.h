@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+// Signal measurements taken by the audio thread once per block
+struct TelemetrySnapshot
+{
+	float lfoPhase = 0;
+	float wetRMS = 0;
+	float wetPeak = 0;
+	float feedbackEnergy = 0;
+};
+
+//==============================================================================
+// Lock-free single-producer, single-consumer mailbox holding the newest telemetry snapshot.
+//
+// This is a triple buffer: the audio thread writes into a slot of its own and swaps it with the
+// shared middle slot, and the editor swaps its slot with the middle one when new data is flagged.
+// The audio thread never blocks or allocates, and every push replaces what the editor has not read
+// yet, so the editor always gets the newest snapshot, even after it has been closed for a while.
+class TelemetryQueue
+{
+public:
+	TelemetryQueue() = default;
+
+	// Called from the audio thread
+	void push(const TelemetrySnapshot& snapshot) noexcept
+	{
+		mSnapshots[mWriteIndex] = snapshot;
+		mWriteIndex = mMiddle.exchange(mWriteIndex | newDataFlag, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// Called from the message thread. Returns false if no snapshot has arrived since the last call.
+	bool popLatest(TelemetrySnapshot& snapshot) noexcept
+	{
+		if ((mMiddle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+			return false;
+
+		mReadIndex = mMiddle.exchange(mReadIndex, std::memory_order_acq_rel) & indexMask;
+		snapshot = mSnapshots[mReadIndex];
+		return true;
+	}
+
+private:
+	// The middle slot index is stored with a flag marking a snapshot the editor has not read
+	static constexpr int indexMask = 3;
+	static constexpr int newDataFlag = 4;
+
+	TelemetrySnapshot mSnapshots[3];
+
+	int mWriteIndex = 0;
+	std::atomic<int> mMiddle { 1 };
+	int mReadIndex = 2;
+};